@@ -0,0 +1,261 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "async_buffer.h"
+
+namespace badgerdb {
+
+Executor::Executor(const std::uint32_t threads)
+  : stopping(false) {
+  for (std::uint32_t i = 0; i < threads; i++)
+    workers.push_back(std::thread(&Executor::run, this));
+}
+
+/**
+   * Destructor of Executor class
+   */
+Executor::~Executor() {
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  for (std::size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+}
+
+/**
+   * Queues a task to run on one of the threads.
+   *
+   * @param task  Task to run
+   */
+void Executor::post(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    tasks.push_back(std::move(task));
+  }
+  wakeup.notify_one();
+}
+
+/**
+   * Thread body: runs queued tasks until the executor stops and the queue is empty.
+   */
+void Executor::run()
+{
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> guard(latch);
+      wakeup.wait(guard, [this] { return stopping || !tasks.empty(); });
+      if (tasks.empty())
+        return;
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+/**
+   * Takes the hit path without suspending if the page is resident. A page with a read
+   * in flight, reserved yet or not, is left to await_suspend() to join that read.
+   */
+bool ReadPageAwaiter::await_ready()
+{
+  std::lock_guard<std::mutex> guard(mgr->latch);
+  if (mgr->inflight.find(AsyncBufMgr::PageKey(file, pageNo)) != mgr->inflight.end())
+    return false;
+  return mgr->bufMgr->readPageIfResident(file, pageNo, page);
+}
+
+/**
+   * Joins the read in flight for the page, or starts one. Checks residency
+   * again under the latch since the page may have been read in meanwhile.
+   *
+   * @param handle  Coroutine to resume once the page is in the pool
+   * @return  False if the page turned out to be resident and the coroutine goes on
+   */
+bool ReadPageAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+  this->handle = handle;
+  std::lock_guard<std::mutex> guard(mgr->latch);
+  const AsyncBufMgr::PageKey key(file, pageNo);
+  std::map<AsyncBufMgr::PageKey, std::vector<ReadPageAwaiter*> >::iterator iter =
+    mgr->inflight.find(key);
+  if (iter != mgr->inflight.end()) {
+    // join the read in flight
+    iter->second.push_back(this);
+    return true;
+  }
+  if (mgr->bufMgr->readPageIfResident(file, pageNo, page))
+    return false;
+
+  // first miss on this page, later ones wait for the same read
+  mgr->inflight[key].push_back(this);
+  mgr->io.post([mgr = mgr, file = file, pageNo = pageNo] { mgr->fill(file, pageNo); });
+  return true;
+}
+
+/**
+   * Returns the pinned page, or rethrows the exception the read raised.
+   */
+Page* ReadPageAwaiter::await_resume()
+{
+  if (error)
+    std::rethrow_exception(error);
+  return page;
+}
+
+AsyncBufMgr::AsyncBufMgr(BufMgr* bufMgr, Executor* executor, const std::uint32_t ioThreads)
+  : bufMgr(bufMgr), executor(executor), io(ioThreads) {
+}
+
+/**
+   * Reads the given page, blocking the calling thread. Waits for a read of the page in flight instead
+   * of reading it again, as the frame reserved for it is not handed out until the page is installed.
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file to be read
+   * @param page    Reference to page pointer, set to the pinned page
+   */
+void AsyncBufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+{
+  const PageKey key(file, pageNo);
+  std::unique_lock<std::mutex> guard(latch);
+  readDone.wait(guard, [this, &key] { return inflight.find(key) == inflight.end(); });
+  bufMgr->readPage(file, pageNo, page);
+}
+
+/**
+   * Unpins a page read through readPageAsync() or readPage().
+   *
+   * @param file    File object
+   * @param pageNo  Page number
+   * @param dirty   True if the page to be unpinned needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+   */
+void AsyncBufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  bufMgr->unPinPage(file, pageNo, dirty);
+}
+
+/**
+   * Allocates a new page. The page is new, so no read of it can be in flight.
+   *
+   * @param file    File object
+   * @param pageNo  Page number assigned to the page, returned via this reference
+   * @param page    Reference to page pointer, set to the pinned page
+   */
+void AsyncBufMgr::allocPage(File* file, PageId& pageNo, Page*& page)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  bufMgr->allocPage(file, pageNo, page);
+}
+
+/**
+   * Writes out and drops the pages of a file once no read of the file is in flight,
+   * since a frame being read into counts as pinned.
+   *
+   * @param file    File object
+   */
+void AsyncBufMgr::flushFile(const File* file)
+{
+  std::unique_lock<std::mutex> guard(latch);
+  readDone.wait(guard, [this, file] {
+    std::map<PageKey, std::vector<ReadPageAwaiter*> >::iterator iter =
+      inflight.lower_bound(PageKey(file, 0));
+    return iter == inflight.end() || iter->first.first != file;
+  });
+  bufMgr->flushFile(file);
+}
+
+/**
+   * Deletes a page once no read of it is in flight.
+   *
+   * @param file    File object
+   * @param pageNo  Page number
+   */
+void AsyncBufMgr::disposePage(File* file, const PageId pageNo)
+{
+  const PageKey key(file, pageNo);
+  std::unique_lock<std::mutex> guard(latch);
+  readDone.wait(guard, [this, &key] { return inflight.find(key) == inflight.end(); });
+  bufMgr->disposePage(file, pageNo);
+}
+
+/**
+   * Reads the page into the pool, pins it once for every waiter and resumes
+   * the waiters on the executor. If the read fails every waiter gets the
+   * exception.
+   *
+   * The frame is reserved under the latch, the page is read into it with
+   * only the file's latch held, and it is installed under the latch again,
+   * so hits and reads of other files go on meanwhile.
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file to be read
+   */
+void AsyncBufMgr::fill(File* file, const PageId pageNo)
+{
+  Page* page = NULL;
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    try {
+      bufMgr->reservePage(file, pageNo, page);
+    } catch (...) {
+      error = std::current_exception();
+    }
+  }
+
+  Page contents;
+  bool diskRead = false;
+  if (!error) {
+    try {
+      diskRead = bufMgr->fetchPage(file, pageNo, contents);
+    } catch (...) {
+      error = std::current_exception();
+    }
+  }
+
+  std::vector<ReadPageAwaiter*> waiters;
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    std::map<PageKey, std::vector<ReadPageAwaiter*> >::iterator iter =
+      inflight.find(PageKey(file, pageNo));
+    waiters.swap(iter->second);
+    inflight.erase(iter);
+
+    if (page != NULL) {
+      if (error)
+        bufMgr->cancelPage(page);
+      else
+        bufMgr->installPage(page, contents, diskRead);
+    }
+    for (std::size_t i = 0; i < waiters.size(); i++) {
+      if (error) {
+        waiters[i]->error = error;
+        continue;
+      }
+      // the first waiter owns the pin taken by the reservation, the others
+      // take their own on the now resident page
+      if (i > 0)
+        bufMgr->readPage(file, pageNo, page);
+      waiters[i]->page = page;
+    }
+  }
+  readDone.notify_all();
+
+  for (std::size_t i = 0; i < waiters.size(); i++) {
+    std::coroutine_handle<> handle = waiters[i]->handle;
+    executor->post([handle] { handle.resume(); });
+  }
+}
+
+}
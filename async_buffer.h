@@ -0,0 +1,213 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Fixed set of threads running posted tasks in FIFO order.
+ */
+class Executor {
+ public:
+  /**
+   * Constructor of Executor class. Starts the threads.
+   *
+   * @param threads  Number of threads
+   */
+  explicit Executor(const std::uint32_t threads);
+
+  /**
+   * Destructor of Executor class. Runs the tasks still queued, then joins the threads.
+   */
+  ~Executor();
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  /**
+   * Queues a task to run on one of the threads.
+   *
+   * @param task  Task to run
+   */
+  void post(std::function<void()> task);
+
+ private:
+  std::mutex latch;
+  std::condition_variable wakeup;
+  std::deque<std::function<void()> > tasks;
+  std::vector<std::thread> workers;
+  bool stopping;
+
+  void run();
+};
+
+class AsyncBufMgr;
+
+/**
+ * @brief Awaitable returned by AsyncBufMgr::readPageAsync().
+ *
+ * Completes without suspending if the page is resident. Otherwise the
+ * coroutine is suspended until the read is done and resumed on the
+ * executor. co_await yields the pinned page, or rethrows what readPage threw.
+ */
+class ReadPageAwaiter {
+ public:
+  ReadPageAwaiter(AsyncBufMgr* mgr, File* file, const PageId pageNo)
+    : mgr(mgr), file(file), pageNo(pageNo), page(NULL) {}
+
+  bool await_ready();
+  bool await_suspend(std::coroutine_handle<> handle);
+  Page* await_resume();
+
+ private:
+  friend class AsyncBufMgr;
+
+  AsyncBufMgr* mgr;
+  File* file;
+  PageId pageNo;
+  Page* page;
+  std::exception_ptr error;
+  std::coroutine_handle<> handle;
+};
+
+/**
+ * @brief Coroutine front end of the buffer manager.
+ *
+ * `Page* page = co_await asyncMgr.readPageAsync(file, pageNo);` takes the
+ * hit path inline. On a miss the coroutine suspends while a thread of the
+ * I/O pool reads the page, so a few executor threads can keep thousands of
+ * requests in flight. Concurrent misses on the same page share one read.
+ *
+ * BufMgr is not thread-safe, so every call into it is made under one latch,
+ * except the disk read of a miss. That read runs on the I/O pool holding
+ * only the latch of its file (see BufMgr::fetchPage()), into a frame
+ * reserved beforehand, so hits and misses on other files go on meanwhile.
+ * File is not thread-safe either, so reads of one file still follow each
+ * other; spreading data over several files lets ioThreads reads overlap.
+ * Dirty pages evicted to make room are written under the latch.
+ *
+ * A frame reserved for a read is marked as loading in the buffer manager
+ * until the page is installed, so no caller is handed it half read. While
+ * this class is in use the buffer manager must still not be called other
+ * than through it, since BufMgr is not thread-safe; readPage(), allocPage(),
+ * flushFile() and disposePage() take the latch and wait for reads in flight
+ * they would otherwise collide with. Code built on BufMgr directly, such as
+ * FreeSpaceMap, must not run meanwhile.
+ */
+class AsyncBufMgr {
+ public:
+  /**
+   * Constructor of AsyncBufMgr class.
+   *
+   * @param bufMgr     Buffer manager pages are read through
+   * @param executor   Executor suspended coroutines are resumed on
+   * @param ioThreads  Number of threads serving misses
+   */
+  AsyncBufMgr(BufMgr* bufMgr, Executor* executor, const std::uint32_t ioThreads);
+
+  /**
+   * Reads the given page, suspending the calling coroutine on a miss.
+   * The page is pinned as by BufMgr::readPage().
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file to be read
+   */
+  ReadPageAwaiter readPageAsync(File* file, const PageId pageNo) {
+    return ReadPageAwaiter(this, file, pageNo);
+  }
+
+  /**
+   * Reads the given page as BufMgr::readPage() does, blocking the calling thread.
+   * Waits for a read of the page in flight instead of reading it again.
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file to be read
+   * @param page    Reference to page pointer, set to the pinned page
+   */
+  void readPage(File* file, const PageId pageNo, Page*& page);
+
+  /**
+   * Unpins a page read through readPageAsync() or readPage().
+   *
+   * @param file    File object
+   * @param pageNo  Page number
+   * @param dirty   True if the page to be unpinned needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+   */
+  void unPinPage(File* file, const PageId pageNo, const bool dirty);
+
+  /**
+   * Allocates a new page as BufMgr::allocPage() does.
+   *
+   * @param file    File object
+   * @param pageNo  Page number assigned to the page, returned via this reference
+   * @param page    Reference to page pointer, set to the pinned page
+   */
+  void allocPage(File* file, PageId& pageNo, Page*& page);
+
+  /**
+   * Writes out and drops the pages of a file as BufMgr::flushFile() does,
+   * once no read of the file is in flight.
+   *
+   * @param file    File object
+   */
+  void flushFile(const File* file);
+
+  /**
+   * Deletes a page as BufMgr::disposePage() does, once no read of it is in flight.
+   *
+   * @param file    File object
+   * @param pageNo  Page number
+   */
+  void disposePage(File* file, const PageId pageNo);
+
+ private:
+  friend class ReadPageAwaiter;
+
+  typedef std::pair<const File*, PageId> PageKey;
+
+  BufMgr* bufMgr;
+  Executor* executor;
+  std::mutex latch;
+
+  /**
+   * Coroutines waiting for each page being read. A page stays here until it
+   * is installed in its reserved frame.
+   */
+  std::map<PageKey, std::vector<ReadPageAwaiter*> > inflight;
+
+  /**
+   * Signalled whenever a read leaves inflight.
+   */
+  std::condition_variable readDone;
+
+  /**
+   * I/O pool, declared last so that it is joined before the state it uses goes away.
+   */
+  Executor io;
+
+  /**
+   * Runs on the I/O pool: reserves a frame, reads the page into it without the latch,
+   * pins it once per waiter and resumes the waiters.
+   */
+  void fill(File* file, const PageId pageNo);
+};
+
+}
@@ -0,0 +1,139 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Pages per second through AsyncBufMgr with a handful of threads and
+ * thousands of coroutines in flight, reading random pages of a dataset
+ * larger than the pool. The dataset is spread over several files since
+ * reads of one file follow each other.
+ *
+ * Usage: bench_async [coroutines] [reads per coroutine] [executor threads] [io threads] [pages] [buffer frames] [files]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "page.h"
+#include "buffer.h"
+#include "async_buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+/**
+ * Coroutine that starts eagerly and frees itself when done.
+ */
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() { return Detached(); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+struct Completion {
+  std::mutex latch;
+  std::condition_variable done;
+  std::uint32_t remaining;
+  std::atomic<std::uint64_t> checksum;
+};
+
+static Detached client(AsyncBufMgr& asyncMgr, std::vector<File>& files, std::uint32_t pages,
+  std::uint32_t reads, std::uint32_t seed, Completion& completion)
+{
+  std::mt19937 rng(seed);
+  std::uint64_t checksum = 0;
+  for (std::uint32_t n = 0; n < reads; n++) {
+    // page p of the dataset is page p / files + 1 of file p % files
+    const std::uint32_t p = rng() % pages;
+    File* file = &files[p % files.size()];
+    const PageId pageNo = p / files.size() + 1;
+    const RecordId rid = {pageNo, 1};
+    Page* page = co_await asyncMgr.readPageAsync(file, pageNo);
+    checksum += page->getRecord(rid)[0];
+    asyncMgr.unPinPage(file, pageNo, false);
+  }
+  completion.checksum += checksum;
+  std::lock_guard<std::mutex> guard(completion.latch);
+  if (--completion.remaining == 0)
+    completion.done.notify_one();
+}
+
+int main(int argc, char* argv[])
+{
+  const std::uint32_t coroutines = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const std::uint32_t reads = argc > 2 ? std::atoi(argv[2]) : 50;
+  const std::uint32_t executorThreads = argc > 3 ? std::atoi(argv[3]) : 4;
+  const std::uint32_t ioThreads = argc > 4 ? std::atoi(argv[4]) : 4;
+  const std::uint32_t pages = argc > 5 ? std::atoi(argv[5]) : 50000;
+  // every coroutine can hold a pin, keep frames free for the misses
+  const std::uint32_t frames = argc > 6 ? std::atoi(argv[6]) : coroutines + 1000;
+  const std::uint32_t fileCount = argc > 7 ? std::atoi(argv[7]) : 4;
+  std::vector<std::string> filenames;
+  for (std::uint32_t f = 0; f < fileCount; f++) {
+    filenames.push_back("bench.async." + std::to_string(f));
+    try {
+      File::remove(filenames[f]);
+    } catch (FileNotFoundException e) {
+    }
+  }
+
+  {
+    std::vector<File> files;
+    files.reserve(fileCount);
+    for (std::uint32_t f = 0; f < fileCount; f++)
+      files.push_back(File::create(filenames[f]));
+    for (std::uint32_t n = 0; n < pages; n++) {
+      Page page = files[n % fileCount].allocatePage();
+      page.insertRecord(std::string(100, 'a' + n % 26));
+      files[n % fileCount].writePage(page);
+    }
+
+    BufMgr bufMgr(frames);
+    Completion completion;
+    completion.remaining = coroutines;
+    completion.checksum = 0;
+    double seconds;
+    {
+      Executor executor(executorThreads);
+      AsyncBufMgr asyncMgr(&bufMgr, &executor, ioThreads);
+
+      auto start = std::chrono::steady_clock::now();
+      for (std::uint32_t c = 0; c < coroutines; c++)
+        executor.post([&asyncMgr, &files, pages, reads, c, &completion] {
+          client(asyncMgr, files, pages, reads, c + 1, completion);
+        });
+      {
+        std::unique_lock<std::mutex> guard(completion.latch);
+        completion.done.wait(guard, [&completion] { return completion.remaining == 0; });
+      }
+      auto end = std::chrono::steady_clock::now();
+      seconds = std::chrono::duration<double>(end - start).count();
+    }
+
+    const BufStats stats = bufMgr.getBufStats();
+    std::cout << "coroutines,reads,executor_threads,io_threads,pages,frames,files,pages_per_sec,"
+      "disk_reads,checksum\n";
+    std::cout << coroutines << "," << (std::uint64_t) coroutines * reads << ","
+      << executorThreads << "," << ioThreads << "," << pages << "," << frames << ","
+      << fileCount << ","
+      << (std::uint64_t) coroutines * reads / seconds << "," << stats.diskreads << ","
+      << completion.checksum << "\n";
+  }
+
+  for (std::uint32_t f = 0; f < fileCount; f++)
+    File::remove(filenames[f]);
+  return 0;
+}
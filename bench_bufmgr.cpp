@@ -0,0 +1,359 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * YCSB-style workload driver for the buffer manager.
+ *
+ * Loads a dataset of one-record pages spread over a number of files, then
+ * runs a mix of reads, updates and inserts against it with a chosen key
+ * distribution and reports throughput, latency percentiles, hit ratio and
+ * I/O counts as CSV or JSON so that runs of different builds can be compared.
+ * hit_ratio covers the page reads of reads and updates, not the new pages
+ * inserts allocate.
+ * An insert appends a new page to the dataset; the latest distribution
+ * favours the most recently inserted pages, as in YCSB workload D.
+ *
+ * Usage: bench_bufmgr [--name=value ...]
+ *   --frames=N      buffer pool size in frames (default 1000)
+ *   --files=N       number of files the dataset is spread over (default 4)
+ *   --pages=N       dataset size in pages over all files (default 10000)
+ *   --ops=N         operations to run over all threads (default 200000)
+ *   --read-pct=N    percentage of reads (default 95)
+ *   --insert-pct=N  percentage of inserts, the rest are updates (default 0)
+ *   --dist=NAME     uniform, zipfian, latest or sequential (default zipfian)
+ *   --theta=X       skew of the zipfian and latest distributions (default 0.99)
+ *   --threads=N     number of client threads (default 1)
+ *   --seed=N        random seed (default 1)
+ *   --format=NAME   csv or json (default csv)
+ *
+ * bytes_written is what write-backs wrote, whole pages each; dirty_sector_bytes
+ * is the part of that in sectors which had changed.
+ *
+ * BufMgr is not thread-safe, so with more than one thread every call is made
+ * under one mutex; latencies include the time spent waiting for it.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "page.h"
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+struct Config {
+  std::uint32_t frames = 1000;
+  std::uint32_t files = 4;
+  std::uint32_t pages = 10000;
+  std::uint64_t ops = 200000;
+  std::uint32_t readPct = 95;
+  std::uint32_t insertPct = 0;
+  std::string dist = "zipfian";
+  double theta = 0.99;
+  std::uint32_t threads = 1;
+  std::uint64_t seed = 1;
+  std::string format = "csv";
+};
+
+/**
+ * Zipfian generator over [0, items) after Gray et al., as used by YCSB.
+ */
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(std::uint64_t items, double theta)
+    : items(items), theta(theta) {
+    double zetan = 0;
+    for (std::uint64_t i = 1; i <= items; i++)
+      zetan += 1.0 / std::pow((double) i, theta);
+    const double zeta2 = 1.0 + 1.0 / std::pow(2.0, theta);
+    this->zetan = zetan;
+    alpha = 1.0 / (1.0 - theta);
+    eta = (1.0 - std::pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+  }
+
+  std::uint64_t next(double u) const {
+    const double uz = u * zetan;
+    if (uz < 1.0)
+      return 0;
+    if (uz < 1.0 + std::pow(0.5, theta))
+      return 1;
+    const std::uint64_t k = (std::uint64_t) (items * std::pow(eta * u - eta + 1.0, alpha));
+    return std::min(k, items - 1);
+  }
+
+ private:
+  std::uint64_t items;
+  double theta;
+  double zetan;
+  double alpha;
+  double eta;
+};
+
+/**
+ * Spreads the hot zipfian ranks over the key space, like YCSB's scrambled zipfian.
+ */
+static std::uint64_t scramble(std::uint64_t rank, std::uint64_t items)
+{
+  std::uint64_t hash = 14695981039346656037ull;
+  for (int i = 0; i < 8; i++) {
+    hash ^= (rank >> (i * 8)) & 0xff;
+    hash *= 1099511628211ull;
+  }
+  return hash % items;
+}
+
+struct ThreadResult {
+  std::vector<std::uint32_t> latencies;
+  std::uint64_t reads = 0;
+  std::uint64_t updates = 0;
+  std::uint64_t inserts = 0;
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+};
+
+static bool parseArg(const char* arg, Config& config)
+{
+  const char* eq = std::strchr(arg, '=');
+  if (std::strncmp(arg, "--", 2) != 0 || eq == NULL)
+    return false;
+  const std::string name(arg + 2, eq);
+  const char* value = eq + 1;
+  if (name == "frames") config.frames = std::strtoul(value, NULL, 10);
+  else if (name == "files") config.files = std::strtoul(value, NULL, 10);
+  else if (name == "pages") config.pages = std::strtoul(value, NULL, 10);
+  else if (name == "ops") config.ops = std::strtoull(value, NULL, 10);
+  else if (name == "read-pct") config.readPct = std::strtoul(value, NULL, 10);
+  else if (name == "insert-pct") config.insertPct = std::strtoul(value, NULL, 10);
+  else if (name == "dist") config.dist = value;
+  else if (name == "theta") config.theta = std::strtod(value, NULL);
+  else if (name == "threads") config.threads = std::strtoul(value, NULL, 10);
+  else if (name == "seed") config.seed = std::strtoull(value, NULL, 10);
+  else if (name == "format") config.format = value;
+  else return false;
+  return true;
+}
+
+static std::uint32_t percentile(const std::vector<std::uint32_t>& sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  const std::size_t index = std::min(sorted.size() - 1, (std::size_t) (p * sorted.size()));
+  return sorted[index];
+}
+
+int main(int argc, char* argv[])
+{
+  Config config;
+  for (int a = 1; a < argc; a++) {
+    if (!parseArg(argv[a], config)) {
+      std::cerr << "unknown argument " << argv[a] << "\n";
+      return 1;
+    }
+  }
+  if (config.dist != "uniform" && config.dist != "zipfian" &&
+      config.dist != "latest" && config.dist != "sequential") {
+    std::cerr << "unknown distribution " << config.dist << "\n";
+    return 1;
+  }
+  if (config.readPct + config.insertPct > 100) {
+    std::cerr << "reads and inserts add up to more than 100 percent\n";
+    return 1;
+  }
+  if (config.files == 0 || config.pages < config.files || config.threads == 0) {
+    std::cerr << "need at least one thread and one page per file\n";
+    return 1;
+  }
+
+  // load phase: page k of the dataset is page k / files + 1 of file k % files
+  std::vector<std::string> filenames;
+  std::vector<File> files;
+  files.reserve(config.files);
+  for (std::uint32_t f = 0; f < config.files; f++) {
+    filenames.push_back("bench.bufmgr." + std::to_string(f));
+    try {
+      File::remove(filenames[f]);
+    } catch (FileNotFoundException e) {
+    }
+    files.push_back(File::create(filenames[f]));
+  }
+  const std::uint32_t pagesPerFile = config.pages / config.files;
+  const std::uint64_t items = (std::uint64_t) pagesPerFile * config.files;
+
+  BufMgr* bufMgr = new BufMgr(config.frames);
+  {
+    PageId pageNo;
+    Page* page;
+    for (std::uint32_t p = 0; p < pagesPerFile; p++) {
+      for (std::uint32_t f = 0; f < config.files; f++) {
+        bufMgr->allocPage(&files[f], pageNo, page);
+        bufMgr->insertRecord(&files[f], pageNo, std::string(100, 'a' + p % 26));
+        bufMgr->unPinPage(&files[f], pageNo, false);
+      }
+    }
+    for (std::uint32_t f = 0; f < config.files; f++)
+      bufMgr->flushFile(&files[f]);
+  }
+  bufMgr->clearBufStats();
+  bufMgr->clearMissRatioCurve();
+  const std::uint64_t dirtySectorsBefore = bufMgr->getDirtySectorBytes();
+  const std::uint64_t writtenBefore = bufMgr->getBytesWritten();
+
+  // run phase: inserts append key count, which becomes readable once counted
+  const ZipfianGenerator zipf(items, config.theta);
+  std::atomic<std::uint64_t> count(items);
+  std::mutex latch;
+  std::vector<ThreadResult> results(config.threads);
+  std::vector<std::thread> threads;
+
+  auto worker = [&](std::uint32_t t) {
+    ThreadResult& result = results[t];
+    const std::uint64_t ops = config.ops / config.threads +
+      (t < config.ops % config.threads ? 1 : 0);
+    result.latencies.reserve(ops);
+    std::mt19937_64 rng(config.seed * 7919 + t);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uint64_t cursor = items * t / config.threads;
+    Page* page;
+
+    for (std::uint64_t n = 0; n < ops; n++) {
+      const std::uint32_t op = rng() % 100;
+      const bool read = op < config.readPct;
+      const bool insert = !read && op < config.readPct + config.insertPct;
+
+      const std::uint64_t current = count.load();
+      std::uint64_t key;
+      if (config.dist == "uniform")
+        key = rng() % current;
+      else if (config.dist == "zipfian")
+        key = scramble(zipf.next(unit(rng)), items);
+      else if (config.dist == "latest")
+        // ranks count back from the newest key and stay below the loaded count
+        key = current - 1 - zipf.next(unit(rng));
+      else
+        key = cursor++ % current;
+
+      auto start = std::chrono::steady_clock::now();
+      if (insert) {
+        std::lock_guard<std::mutex> guard(latch);
+        // keys are appended in order, so key k lands on page k / files + 1
+        // of file k % files like the loaded ones
+        const std::uint64_t newKey = count.load();
+        File* file = &files[newKey % config.files];
+        PageId pageNo;
+        bufMgr->allocPage(file, pageNo, page);
+        bufMgr->insertRecord(file, pageNo, std::string(100, 'a' + n % 26));
+        bufMgr->unPinPage(file, pageNo, false);
+        count.store(newKey + 1);
+      } else {
+        File* file = &files[key % config.files];
+        const PageId pageNo = key / config.files + 1;
+        std::lock_guard<std::mutex> guard(latch);
+        // allocPage() counts accesses without disk reads too, so hits are
+        // only counted here, for the reads and updates of existing pages
+        const int diskreads = bufMgr->getBufStats().diskreads;
+        bufMgr->readPage(file, pageNo, page);
+        if (bufMgr->getBufStats().diskreads == diskreads)
+          result.hits++;
+        else
+          result.misses++;
+        if (!read) {
+          const RecordId rid = {pageNo, 1};
+          bufMgr->updateRecord(file, rid, std::string(100, 'a' + n % 26));
+        }
+        bufMgr->unPinPage(file, pageNo, false);
+      }
+      auto end = std::chrono::steady_clock::now();
+
+      result.latencies.push_back((std::uint32_t)
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+      if (read)
+        result.reads++;
+      else if (insert)
+        result.inserts++;
+      else
+        result.updates++;
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint32_t t = 0; t < config.threads; t++)
+    threads.push_back(std::thread(worker, t));
+  for (std::uint32_t t = 0; t < config.threads; t++)
+    threads[t].join();
+  auto end = std::chrono::steady_clock::now();
+  const double seconds = std::chrono::duration<double>(end - start).count();
+
+  std::vector<std::uint32_t> latencies;
+  std::uint64_t reads = 0;
+  std::uint64_t updates = 0;
+  std::uint64_t inserts = 0;
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  for (std::uint32_t t = 0; t < config.threads; t++) {
+    latencies.insert(latencies.end(), results[t].latencies.begin(), results[t].latencies.end());
+    reads += results[t].reads;
+    updates += results[t].updates;
+    inserts += results[t].inserts;
+    hits += results[t].hits;
+    misses += results[t].misses;
+  }
+  const std::uint64_t ops = reads + updates + inserts;
+  std::sort(latencies.begin(), latencies.end());
+
+  const BufStats stats = bufMgr->getBufStats();
+  const double hitRatio = hits + misses == 0 ? 0.0 : (double) hits / (hits + misses);
+  const std::uint64_t dirtySectorBytes = bufMgr->getDirtySectorBytes() - dirtySectorsBefore;
+  const std::uint64_t bytesWritten = bufMgr->getBytesWritten() - writtenBefore;
+  const double predicted = bufMgr->getMissRatioCurve().predictHitRatio(config.frames);
+  const double throughput = ops / seconds;
+  const std::uint32_t p50 = percentile(latencies, 0.50);
+  const std::uint32_t p99 = percentile(latencies, 0.99);
+  const std::uint32_t p999 = percentile(latencies, 0.999);
+
+  if (config.format == "json") {
+    std::cout << "{\"frames\":" << config.frames << ",\"files\":" << config.files
+      << ",\"pages\":" << items << ",\"ops\":" << ops
+      << ",\"read_pct\":" << config.readPct << ",\"insert_pct\":" << config.insertPct
+      << ",\"dist\":\"" << config.dist
+      << "\",\"theta\":" << config.theta << ",\"threads\":" << config.threads
+      << ",\"seconds\":" << seconds << ",\"ops_per_sec\":" << throughput
+      << ",\"p50_ns\":" << p50 << ",\"p99_ns\":" << p99 << ",\"p999_ns\":" << p999
+      << ",\"hit_ratio\":" << hitRatio << ",\"predicted_hit_ratio\":" << predicted
+      << ",\"disk_reads\":" << stats.diskreads
+      << ",\"disk_writes\":" << stats.diskwrites
+      << ",\"dirty_sector_bytes\":" << dirtySectorBytes
+      << ",\"bytes_written\":" << bytesWritten << "}\n";
+  } else {
+    std::cout << "frames,files,pages,ops,read_pct,insert_pct,dist,theta,threads,seconds,ops_per_sec,"
+      "p50_ns,p99_ns,p999_ns,hit_ratio,predicted_hit_ratio,disk_reads,disk_writes,"
+      "dirty_sector_bytes,bytes_written\n";
+    std::cout << config.frames << "," << config.files << "," << items << ","
+      << ops << "," << config.readPct << "," << config.insertPct << "," << config.dist << ","
+      << config.theta << "," << config.threads << "," << seconds << "," << throughput
+      << "," << p50 << "," << p99 << "," << p999 << "," << hitRatio << "," << predicted << ","
+      << stats.diskreads << "," << stats.diskwrites << "," << dirtySectorBytes
+      << "," << bytesWritten << "\n";
+  }
+
+  for (std::uint32_t f = 0; f < config.files; f++)
+    bufMgr->flushFile(&files[f]);
+  delete bufMgr;
+  files.clear();
+  for (std::uint32_t f = 0; f < config.files; f++)
+    File::remove(filenames[f]);
+  return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Mixed insert/delete benchmark comparing record placement through the
+ * free-space map with the probing strategy callers use without it: insert on
+ * the last page written and allocate a new page when it is full.
+ *
+ * Usage: bench_fsm [operations] [delete percentage] [buffer frames]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "page.h"
+#include "buffer.h"
+#include "file_iterator.h"
+#include "free_space_map.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+struct Result {
+  double seconds;
+  std::uint32_t pages;
+};
+
+static std::string makeRecord(std::uint32_t n)
+{
+  // records between 16 and 400 bytes so that freed holes differ in size
+  return std::string(16 + (n * 2654435761u) % 385, 'a' + n % 26);
+}
+
+static std::uint32_t countPages(File& file)
+{
+  std::uint32_t pages = 0;
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+    pages++;
+  return pages;
+}
+
+static void removeFile(const std::string& filename)
+{
+  try {
+    File::remove(filename);
+  } catch (FileNotFoundException e) {
+  }
+}
+
+static Result runProbe(std::uint32_t ops, std::uint32_t deletePct, std::uint32_t frames)
+{
+  const std::string filename = "bench.probe";
+  removeFile(filename);
+  Result result;
+  {
+    File file = File::create(filename);
+    BufMgr bufMgr(frames);
+    std::vector<RecordId> live;
+    PageId current = Page::INVALID_NUMBER;
+    Page* page;
+    srandom(1);
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint32_t n = 0; n < ops; n++) {
+      if (!live.empty() && (std::uint32_t) (random() % 100) < deletePct) {
+        const std::size_t victim = random() % live.size();
+        const RecordId rid = live[victim];
+        bufMgr.readPage(&file, rid.page_number, page);
+        bufMgr.deleteRecord(&file, rid);
+        bufMgr.unPinPage(&file, rid.page_number, false);
+        live[victim] = live.back();
+        live.pop_back();
+        continue;
+      }
+      const std::string record = makeRecord(n);
+      if (current != Page::INVALID_NUMBER) {
+        bufMgr.readPage(&file, current, page);
+        if (page->hasSpaceForRecord(record)) {
+          live.push_back(bufMgr.insertRecord(&file, current, record));
+          bufMgr.unPinPage(&file, current, false);
+          continue;
+        }
+        bufMgr.unPinPage(&file, current, false);
+      }
+      bufMgr.allocPage(&file, current, page);
+      live.push_back(bufMgr.insertRecord(&file, current, record));
+      bufMgr.unPinPage(&file, current, false);
+    }
+    bufMgr.flushFile(&file);
+    auto end = std::chrono::steady_clock::now();
+
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.pages = countPages(file);
+  }
+  removeFile(filename);
+  return result;
+}
+
+static Result runFsm(std::uint32_t ops, std::uint32_t deletePct, std::uint32_t frames)
+{
+  const std::string dataname = "bench.fsm";
+  const std::string mapname = "bench.fsm.map";
+  removeFile(dataname);
+  removeFile(mapname);
+  Result result;
+  {
+    File datafile = File::create(dataname);
+    File mapfile = File::create(mapname);
+    BufMgr bufMgr(frames);
+    FreeSpaceMap fsm(&bufMgr, &datafile, &mapfile);
+    std::vector<RecordId> live;
+    srandom(1);
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint32_t n = 0; n < ops; n++) {
+      if (!live.empty() && (std::uint32_t) (random() % 100) < deletePct) {
+        const std::size_t victim = random() % live.size();
+        fsm.deleteRecord(live[victim]);
+        live[victim] = live.back();
+        live.pop_back();
+        continue;
+      }
+      live.push_back(fsm.insertRecord(makeRecord(n)));
+    }
+    bufMgr.flushFile(&datafile);
+    bufMgr.flushFile(&mapfile);
+    auto end = std::chrono::steady_clock::now();
+
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.pages = countPages(datafile) + countPages(mapfile);
+  }
+  removeFile(dataname);
+  removeFile(mapname);
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  const std::uint32_t ops = argc > 1 ? std::atoi(argv[1]) : 200000;
+  const std::uint32_t deletePct = argc > 2 ? std::atoi(argv[2]) : 40;
+  const std::uint32_t frames = argc > 3 ? std::atoi(argv[3]) : 100;
+
+  const Result probe = runProbe(ops, deletePct, frames);
+  const Result fsm = runFsm(ops, deletePct, frames);
+
+  std::cout << "strategy,ops,delete_pct,frames,ops_per_sec,file_pages,file_bytes\n";
+  std::cout << "probe," << ops << "," << deletePct << "," << frames << ","
+    << ops / probe.seconds << "," << probe.pages << ","
+    << (std::uint64_t) probe.pages * Page::SIZE << "\n";
+  std::cout << "fsm," << ops << "," << deletePct << "," << frames << ","
+    << ops / fsm.seconds << "," << fsm.pages << ","
+    << (std::uint64_t) fsm.pages * Page::SIZE << "\n";
+  return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Read throughput of the buffer manager (read system call plus copy into the
+ * pool on every miss) against the memory-mapped read-only path, for
+ * sequential and random page access on a file larger than the pool.
+ *
+ * Usage: bench_mmap [file pages] [buffer frames] [reads]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "page.h"
+#include "buffer.h"
+#include "mapped_file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+static std::vector<PageId> makeOrder(std::uint32_t pages, std::uint32_t reads, bool sequential)
+{
+  std::vector<PageId> order(reads);
+  srandom(1);
+  for (std::uint32_t n = 0; n < reads; n++)
+    order[n] = sequential ? n % pages + 1 : random() % pages + 1;
+  return order;
+}
+
+static double runBufMgr(File& file, std::uint32_t frames, const std::vector<PageId>& order,
+  std::uint64_t& checksum)
+{
+  BufMgr bufMgr(frames);
+  Page* page;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t n = 0; n < order.size(); n++) {
+    const RecordId rid = {order[n], 1};
+    bufMgr.readPage(&file, order[n], page);
+    checksum += page->getRecord(rid)[0];
+    bufMgr.unPinPage(&file, order[n], false);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+static double runMapped(MappedFile& mapped, const std::vector<PageId>& order,
+  std::uint64_t& checksum)
+{
+  std::uint16_t length;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t n = 0; n < order.size(); n++) {
+    const RecordId rid = {order[n], 1};
+    checksum += mapped.getRecord(rid, length)[0];
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 20000;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 1000;
+  const std::uint32_t reads = argc > 3 ? std::atoi(argv[3]) : 200000;
+  const std::string filename = "bench.mmap";
+
+  try {
+    File::remove(filename);
+  } catch (FileNotFoundException e) {
+  }
+
+  {
+    File file = File::create(filename);
+    // one record filling most of every page
+    for (std::uint32_t n = 0; n < pages; n++) {
+      Page page = file.allocatePage();
+      page.insertRecord(std::string(Page::SIZE / 2, 'a' + n % 26));
+      file.writePage(page);
+    }
+
+    MappedFile mapped(filename);
+    std::cout << "access,path,pages,frames,reads,pages_per_sec,checksum\n";
+    for (int sequential = 1; sequential >= 0; sequential--) {
+      const std::vector<PageId> order = makeOrder(pages, reads, sequential);
+      const char* access = sequential ? "sequential" : "random";
+
+      std::uint64_t checksum = 0;
+      double seconds = runBufMgr(file, frames, order, checksum);
+      std::cout << access << ",pread_copy," << pages << "," << frames << "," << reads
+        << "," << reads / seconds << "," << checksum << "\n";
+
+      checksum = 0;
+      seconds = runMapped(mapped, order, checksum);
+      std::cout << access << ",mmap," << pages << "," << frames << "," << reads
+        << "," << reads / seconds << "," << checksum << "\n";
+    }
+  }
+
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,192 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Many threads reading a small set of hot pages, either pinned through
+ * readPage()/unPinPage() or optimistically through readPageOptimistic() and
+ * validateOptimistic(). One optional writer thread keeps updating the hot
+ * pages so that validation failures and retries are exercised.
+ *
+ * Usage: bench_optimistic [threads] [hot pages] [reads per thread] [writer on/off]
+ *
+ * BufMgr is not thread-safe, so the pinned readers, the writer and the
+ * optimistic readers' lookups all go through one mutex. An optimistic reader
+ * only takes it again after a failed validation.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "page.h"
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+struct Shared {
+  BufMgr* bufMgr;
+  File* file;
+  std::uint32_t hotPages;
+  std::uint32_t reads;
+  std::mutex latch;
+  std::atomic<bool> stop;
+  std::atomic<std::uint64_t> retries;
+  std::atomic<std::uint64_t> checksum;
+};
+
+static void pinnedReader(Shared& shared, std::uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uint64_t checksum = 0;
+  Page* page;
+  for (std::uint32_t n = 0; n < shared.reads; n++) {
+    const PageId pageNo = rng() % shared.hotPages + 1;
+    const RecordId rid = {pageNo, 1};
+    std::lock_guard<std::mutex> guard(shared.latch);
+    shared.bufMgr->readPage(shared.file, pageNo, page);
+    checksum += page->getRecord(rid)[0];
+    shared.bufMgr->unPinPage(shared.file, pageNo, false);
+  }
+  shared.checksum += checksum;
+}
+
+static void optimisticReader(Shared& shared, std::uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uint64_t checksum = 0;
+  std::uint64_t retries = 0;
+  // frame and version of every hot page as last looked up
+  std::vector<FrameId> frames(shared.hotPages + 1);
+  std::vector<std::uint64_t> versions(shared.hotPages + 1);
+  std::vector<bool> known(shared.hotPages + 1, false);
+
+  for (std::uint32_t n = 0; n < shared.reads; n++) {
+    const PageId pageNo = rng() % shared.hotPages + 1;
+    const RecordId rid = {pageNo, 1};
+    while (true) {
+      if (!known[pageNo]) {
+        std::lock_guard<std::mutex> guard(shared.latch);
+        if (!shared.bufMgr->readPageOptimistic(shared.file, pageNo,
+            frames[pageNo], versions[pageNo])) {
+          // not resident or being written, bring it in the pinned way
+          Page* page;
+          shared.bufMgr->readPage(shared.file, pageNo, page);
+          shared.bufMgr->unPinPage(shared.file, pageNo, false);
+          continue;
+        }
+        known[pageNo] = true;
+      }
+      char first = 0;
+      try {
+        first = shared.bufMgr->bufPool[frames[pageNo]].getRecord(rid)[0];
+      } catch (...) {
+        // a torn read may look like a bad slot, validation decides
+      }
+      if (shared.bufMgr->validateOptimistic(frames[pageNo], versions[pageNo])) {
+        checksum += first;
+        break;
+      }
+      known[pageNo] = false;
+      retries++;
+    }
+  }
+  shared.checksum += checksum;
+  shared.retries += retries;
+}
+
+static void writer(Shared& shared)
+{
+  std::uint32_t n = 0;
+  Page* page;
+  while (!shared.stop) {
+    const PageId pageNo = n % shared.hotPages + 1;
+    const RecordId rid = {pageNo, 1};
+    {
+      std::lock_guard<std::mutex> guard(shared.latch);
+      shared.bufMgr->readPage(shared.file, pageNo, page);
+      shared.bufMgr->updateRecord(shared.file, rid, std::string(100, 'a' + n % 26));
+      shared.bufMgr->unPinPage(shared.file, pageNo, false);
+    }
+    n++;
+    std::this_thread::yield();
+  }
+}
+
+static double run(Shared& shared, std::uint32_t threads, bool optimistic, bool withWriter)
+{
+  std::vector<std::thread> readers;
+  shared.stop = false;
+  shared.retries = 0;
+  shared.checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::thread writerThread;
+  if (withWriter)
+    writerThread = std::thread(writer, std::ref(shared));
+  for (std::uint32_t t = 0; t < threads; t++)
+    readers.push_back(std::thread(optimistic ? optimisticReader : pinnedReader,
+      std::ref(shared), t + 1));
+  for (std::uint32_t t = 0; t < threads; t++)
+    readers[t].join();
+  auto end = std::chrono::steady_clock::now();
+  shared.stop = true;
+  if (withWriter)
+    writerThread.join();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+  const std::uint32_t threads = argc > 1 ? std::atoi(argv[1]) : 32;
+  const std::uint32_t hotPages = argc > 2 ? std::atoi(argv[2]) : 8;
+  const std::uint32_t reads = argc > 3 ? std::atoi(argv[3]) : 200000;
+  const bool withWriter = argc > 4 ? std::string(argv[4]) == "on" : false;
+  const std::string filename = "bench.optimistic";
+
+  try {
+    File::remove(filename);
+  } catch (FileNotFoundException e) {
+  }
+
+  {
+    File file = File::create(filename);
+    BufMgr bufMgr(hotPages + 16);
+    PageId pageNo;
+    Page* page;
+    for (std::uint32_t n = 0; n < hotPages; n++) {
+      bufMgr.allocPage(&file, pageNo, page);
+      page->insertRecord(std::string(100, 'a' + n % 26));
+      bufMgr.unPinPage(&file, pageNo, true);
+    }
+
+    Shared shared;
+    shared.bufMgr = &bufMgr;
+    shared.file = &file;
+    shared.hotPages = hotPages;
+    shared.reads = reads;
+
+    std::cout << "mode,threads,hot_pages,reads,writer,reads_per_sec,retries,checksum\n";
+    for (int optimistic = 0; optimistic <= 1; optimistic++) {
+      const double seconds = run(shared, threads, optimistic, withWriter);
+      std::cout << (optimistic ? "optimistic" : "pinned") << "," << threads << ","
+        << hotPages << "," << (std::uint64_t) threads * reads << ","
+        << (withWriter ? "on" : "off") << ","
+        << (std::uint64_t) threads * reads / seconds << "," << shared.retries << ","
+        << shared.checksum << "\n";
+    }
+
+    bufMgr.flushFile(&file);
+  }
+
+  File::remove(filename);
+  return 0;
+}
@@ -15,8 +15,17 @@
  */
 
 #include <memory>
+#include <cassert>
 #include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
 #include "buffer.h"
+#include "miss_ratio_curve.h"
+#include "file_quota.h"
+#include "swip.h"
+#include "secondary_cache.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
@@ -25,6 +34,34 @@
 
 namespace badgerdb { 
 
+/**
+ * Granularity of dirty tracking, one bit per sector of a frame.
+ */
+static const std::uint32_t SECTOR_SIZE = 512;
+static const std::uint16_t ALL_SECTORS = 0xffff;
+static_assert(Page::SIZE / SECTOR_SIZE <= 16, "dirty sectors of a page must fit in 16 bits");
+
+/**
+ * Offset in the page, as File writes it, of a byte of the page's data: the header comes
+ * first, then the slots growing up and the records growing down from the end of the data.
+ *
+ * @param offset  Offset in the data, as slots and the header's bounds hold it
+ */
+static std::uint32_t pageOffset(const std::uint32_t offset)
+{
+  return sizeof(PageHeader) + offset;
+}
+
+/**
+ * Offset in the page, as File writes it, of a slot.
+ *
+ * @param slot    Slot number
+ */
+static std::uint32_t slotOffset(const SlotId slot)
+{
+  return pageOffset((slot - 1) * sizeof(PageSlot));
+}
+
 BufMgr::BufMgr(std::uint32_t bufs)
   : numBufs(bufs) {
   bufDescTable = new BufDesc[bufs];
@@ -36,6 +73,30 @@ BufMgr::BufMgr(std::uint32_t bufs)
   }
 
   bufPool = new Page[bufs];
+  // every frame starts empty at version 0
+  frameVersions = new std::atomic<std::uint64_t>[bufs]();
+
+  // no frame is referenced by a swizzled swip yet
+  swipOwners = new Swip*[bufs]();
+  swipParents = new FrameId[bufs];
+  swizzledChildren = new std::uint32_t[bufs]();
+  for (FrameId i = 0; i < bufs; i++)
+    swipParents[i] = bufs;
+
+  secondaryCache = NULL;
+
+  // no frame is being read into yet
+  loadingFrames = new bool[bufs]();
+
+  // frames get the quota of their file and the sample key of their page
+  // when a page is put in them
+  frameQuotas = new FileQuota*[bufs]();
+  frameSampleKeys = new std::uint64_t[bufs];
+
+  // no sector of any frame is dirty yet
+  dirtySectors = new std::uint16_t[bufs]();
+  dirtySectorBytes = 0;
+  bytesWritten = 0;
 
   int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
@@ -51,14 +112,29 @@ BufMgr::~BufMgr() {
     // flush dirty pages into files
     if (bufDescTable[i].dirty == true){
       if (File::isOpen(bufDescTable[i].file->filename())){
-        (*(bufDescTable[i].file)).writePage(bufPool[i]);
+        writeFrame(i);
         bufDescTable[i].dirty = false;
+        if (secondaryCache != NULL)
+          secondaryCache->invalidate(bufDescTable[i].file, bufDescTable[i].pageNo);
       } 
     }
   }
+  // swips outliving the buffer manager go back to page numbers
+  for (FrameId i = 0; i < numBufs; i++)
+    if (swipOwners[i] != NULL)
+      unswizzle(*swipOwners[i]);
   // deallocate buf poll, buf desctable and hash table
   bufPool = NULL;
   bufDescTable = NULL;
+  delete[] frameVersions;
+  frameVersions = NULL;
+  delete[] swipOwners;
+  delete[] swipParents;
+  delete[] swizzledChildren;
+  delete[] dirtySectors;
+  delete[] loadingFrames;
+  delete[] frameQuotas;
+  delete[] frameSampleKeys;
   hashTable->~BufHashTbl();
 }
 
@@ -73,11 +149,14 @@ void BufMgr::advanceClock()
 
 /**
    * Allocate a free frame.  
+   * Frames of other files are not taken while those files are at or below their reservation,
+   * and a file at its cap only gets frames back from its own pages.
    *
    * @param frame     Frame reference, frame ID of allocated frame returned via this variable
+   * @param file      File object the frame is allocated for
    * @throws BufferExceededException If no such buffer is found which can be allocated
    */
-void BufMgr::allocBuf(FrameId & frame) 
+void BufMgr::allocBuf(FrameId & frame, const File* file) 
 {
     // go through all the frames to check
     // whether there is a bufferexceed exception
@@ -87,13 +166,24 @@ void BufMgr::allocBuf(FrameId & frame)
         pinned = false;
     if (pinned) throw BufferExceededException();
      // std::cout<<"pass pinned \n";
-    // if there is no exception
-    while (true) {
+    const FileQuota& quota = fileQuota(file);
+    const bool atCap = quota.resident >= quota.cap;
+    // frames of other files are told apart by their quota, kept per file name
+    // if there is no exception, two rounds of the clock clear every
+    // reference bit and then reach every frame that may be taken
+    for (std::uint32_t tries = 0; tries <= 2 * numBufs; tries++) {
        advanceClock();
       // if there is no valid page in frame
       if (!bufDescTable[frame].valid) {
-        break;
+        // an empty frame would grow the file beyond its cap
+        if (!atCap)
+          return;
       } else {
+        // frames protected by quotas are passed over without a second chance
+        FileQuota* owner = frameQuotas[frame];
+        if (atCap ? owner != &quota
+            : owner != &quota && owner->resident <= owner->reserve)
+          continue;
         // if there is a valid page in frame
         if (bufDescTable[frame].refbit){
           // if frame is used recently,turn it to false
@@ -104,19 +194,92 @@ void BufMgr::allocBuf(FrameId & frame)
           // else it should advance
           if (bufDescTable[frame].pinCnt == 0){
             // check ditry, if dirty, flush
+            const bool changed = bufDescTable[frame].dirty;
             if (bufDescTable[frame].dirty){
-              (*(bufDescTable[frame].file)).writePage(bufPool[frame]);
+              writeFrame(frame);
             }
+              // the page is clean now, keep a copy in the second-level cache
+              if (secondaryCache != NULL)
+                secondaryCache->admit(bufDescTable[frame].file, bufPool[frame], changed);
               // remove the relation in the hash table and clear the frame
               hashTable->remove(bufDescTable[frame].file, 
                 bufDescTable[frame].pageNo);
+              owner->resident--;
+              unswizzleFrame(frame);
+              invalidateFrame(frame);
               bufDescTable[frame].Clear();
-              break;
+              return;
           }
         }
       }
 //      advanceClock(); 
     }
+    // every frame that could be taken is pinned
+    throw BufferExceededException();
+}
+
+/**
+   * Sets the number of frames reserved for a file and the most frames it may hold.
+   * Pages already resident beyond a lowered cap are not evicted, the file just gets no new frames.
+   *
+   * @param file     File object
+   * @param reserve  Frames of this file other files may not take
+   * @param cap      Most frames this file may hold
+   */
+void BufMgr::setFileQuota(const File* file, const std::uint32_t reserve, const std::uint32_t cap)
+{
+  FileQuota& quota = fileQuota(file);
+  quota.reserve = reserve;
+  quota.cap = cap;
+}
+
+/**
+   * Sets the second-level cache clean pages go to when they leave the buffer pool,
+   * and misses are looked up in before reading the file. NULL turns it off.
+   *
+   * @param cache   Second-level cache, not owned by the buffer manager
+   */
+void BufMgr::setSecondaryCache(SecondaryCache* cache)
+{
+  secondaryCache = cache;
+}
+
+/**
+   * Returns the quota, residency and hit counters of a file.
+   *
+   * @param file    File object
+   */
+const FileQuota& BufMgr::getFileQuota(const File* file)
+{
+  return fileQuota(file);
+}
+
+/**
+   * Returns the quota entry of a file, creating one without reservation or cap.
+   * Entries are kept by file name, as flushFile() matches files, so a File object
+   * created later at the address of a closed one does not inherit its quota.
+   * Hit paths go through the entry a frame points at instead of calling this.
+   *
+   * @param file    File object
+   */
+FileQuota& BufMgr::fileQuota(const File* file)
+{
+  std::unordered_map<std::string, FileQuota>::iterator iter = fileQuotas.find(file->filename());
+  if (iter == fileQuotas.end())
+    iter = fileQuotas.insert(std::make_pair(file->filename(), FileQuota(numBufs))).first;
+  return iter->second;
+}
+
+/**
+   * Returns the latch all I/O on a file is done under, creating it if needed.
+   * Safe to call without serialising against other calls.
+   *
+   * @param file    File object
+   */
+std::mutex& BufMgr::fileLatch(const File* file)
+{
+  std::lock_guard<std::mutex> guard(fileLatchesLatch);
+  return fileLatches[file];
 }
 
 /**
@@ -129,26 +292,229 @@ void BufMgr::allocBuf(FrameId & frame)
    * @param page    Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
    */
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+{
+    // if it is in the buffer pool
+    if (readPageIfResident(file, pageNo, page))
+        return;
+    // a page still being read into its reserved frame is neither resident nor to be read again
+    FrameId temp = numBufs;
+    try {
+        hashTable->lookup(file, pageNo, temp);
+    } catch(HashNotFoundException& e1) {
+    }
+    if (temp != numBufs)
+        throw PagePinnedException(file->filename(), pageNo, temp);
+    // if it is not, read it into a new frame
+    reservePage(file, pageNo, page);
+    try {
+        Page contents;
+        const bool diskRead = fetchPage(file, pageNo, contents);
+        installPage(page, contents, diskRead);
+    } catch(...) {
+        cancelPage(page);
+        throw;
+    }
+}
+
+/**
+   * First step of reading a page which is not in the buffer pool: allocates a frame for it,
+   * enters it in the hash table and pins it, but does not read it. Until installPage() or
+   * cancelPage() the frame is marked as loading: readPageIfResident() does not count the
+   * page as present, readPage() throws PagePinnedException for it and optimistic reads fail.
+   *
+   * @param file    File object
+   * @param PageNo  Page number in the file to be read
+   * @param page    Reference to page pointer. The frame the page is to be read into is returned via this reference.
+   * @throws BufferExceededException If no frame can be allocated
+   */
+void BufMgr::reservePage(File* file, const PageId pageNo, Page*& page)
+{
+    bufStats.accesses++;
+    const std::uint64_t sampleKey = missRatioCurve.sampleKey(file, pageNo);
+    missRatioCurve.sample(sampleKey);
+    FileQuota& quota = fileQuota(file);
+    quota.misses++;
+    allocBuf(clockHand, file);
+    // optimistic readers fail on the frame until the page is installed
+    invalidateFrame(clockHand);
+    // insert it into hashtable
+    hashTable->insert(file, pageNo, clockHand);
+    // invoke set()
+    bufDescTable[clockHand].Set(file, pageNo);
+    loadingFrames[clockHand] = true;
+    frameQuotas[clockHand] = &quota;
+    frameSampleKeys[clockHand] = sampleKey;
+    quota.resident++;
+    page = &(bufPool[clockHand]);
+}
+
+/**
+   * Reads a page from the second-level cache or else from its file, without touching the buffer pool.
+   * Only takes the file's latch, so it may run concurrently with other calls, as the second step
+   * of reading a page reserved by reservePage().
+   *
+   * @param file      File object
+   * @param PageNo    Page number in the file to be read
+   * @param contents  Filled with the page
+   * @return  True if the page was read from the file rather than from the second-level cache
+   */
+bool BufMgr::fetchPage(File* file, const PageId pageNo, Page& contents)
+{
+    if (secondaryCache != NULL && secondaryCache->lookup(file, pageNo, contents))
+        return false;
+    std::lock_guard<std::mutex> guard(fileLatch(file));
+    contents = file->readPage(pageNo);
+    return true;
+}
+
+/**
+   * Last step of reading a page: copies the contents fetched by fetchPage() into the frame
+   * returned by reservePage(), which then holds the page pinned once.
+   *
+   * @param page      Frame returned by reservePage()
+   * @param contents  Page contents
+   * @param diskRead  True if the contents were read from the file
+   */
+void BufMgr::installPage(Page* page, const Page& contents, const bool diskRead)
+{
+    const FrameId frame = page - bufPool;
+    // copy rather than move, so the frame keeps its storage and an optimistic
+    // reader still in it sees changing bytes, never freed memory
+    bufPool[frame] = contents;
+    if (diskRead)
+        bufStats.diskreads++;
+    loadingFrames[frame] = false;
+    publishFrame(frame);
+}
+
+/**
+   * Gives back a frame returned by reservePage() whose page could not be read.
+   *
+   * @param page    Frame returned by reservePage()
+   */
+void BufMgr::cancelPage(Page* page)
+{
+    const FrameId frame = page - bufPool;
+    hashTable->remove(bufDescTable[frame].file, bufDescTable[frame].pageNo);
+    frameQuotas[frame]->resident--;
+    loadingFrames[frame] = false;
+    bufDescTable[frame].Clear();
+}
+
+/**
+   * Pins the given page and returns the pointer to it only if it is already present in the buffer pool.
+   * Never reads from the file, so it can be used to take the hit path without blocking on a disk read.
+   * A page still being read into a frame reserved by reservePage() is not present yet.
+   *
+   * @param file    File object
+   * @param PageNo  Page number in the file
+   * @param page    Reference to page pointer. Set to the frame holding the page if it is present.
+   * @return  True if the page was present and has been pinned
+   */
+bool BufMgr::readPageIfResident(File* file, const PageId pageNo, Page*& page)
 {
     FrameId temp = 0;
     try {
-        // look up file and pageid in the hashtable
         hashTable->lookup(file, pageNo, temp);
-        // if it is in the buffer pool
-        bufDescTable[temp].refbit = true;
-        bufDescTable[temp].pinCnt = bufDescTable[temp].pinCnt + 1;
-        page = &(bufPool[temp]);
     } catch(HashNotFoundException& e1) {
-        // if it is not in the buffer pool
-        allocBuf(clockHand);
-        // read page from file and insert it into buffer pool
-        bufPool[clockHand] = file->readPage(pageNo);
-        // insert it into hashtable
-        hashTable->insert(file, pageNo, clockHand);
-        // invoke set()
-        bufDescTable[clockHand].Set(file, pageNo);
-        page = &(bufPool[clockHand]);
+        // the access is counted by reservePage() when the caller reads the page in
+        return false;
     }
+    if (loadingFrames[temp])
+        return false;
+    bufStats.accesses++;
+    missRatioCurve.sample(frameSampleKeys[temp]);
+    bufDescTable[temp].refbit = true;
+    bufDescTable[temp].pinCnt = bufDescTable[temp].pinCnt + 1;
+    frameQuotas[temp]->hits++;
+    page = &(bufPool[temp]);
+    return true;
+}
+
+/**
+   * Reads the page a swip refers to and swizzles the swip, so that following it again goes
+   * straight to the frame without a hash table lookup. The swip is turned back into the page
+   * number when the page leaves its frame, or when the parent page leaves its frame.
+   * The page is unpinned with the unPinPage() overload taking the swip, which also skips the
+   * hash table while the swip is swizzled.
+   *
+   * @param file    File object
+   * @param swip    Reference to the page to be read
+   * @param page    Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+   * @param parent  Pinned page the swip was read from, or NULL if it is not tied to a page
+   */
+void BufMgr::readPage(File* file, Swip& swip, Page*& page, const Page* parent)
+{
+    if (swip.isSwizzled()) {
+        // the page is resident in the frame the swip holds; everything
+        // kept per page is reached through the frame, without hashing
+        const FrameId frame = swip.frame();
+        assert(bufDescTable[frame].file == file);
+        bufStats.accesses++;
+        missRatioCurve.sample(frameSampleKeys[frame]);
+        bufDescTable[frame].refbit = true;
+        bufDescTable[frame].pinCnt = bufDescTable[frame].pinCnt + 1;
+        frameQuotas[frame]->hits++;
+        page = &(bufPool[frame]);
+        return;
+    }
+
+    readPage(file, swip.pageNo(), page);
+    const FrameId frame = page - bufPool;
+    // a frame is referenced by at most one swizzled swip, others keep the page number
+    if (swipOwners[frame] != NULL)
+        return;
+    swip.swizzle(frame, this);
+    swipOwners[frame] = &swip;
+    if (parent != NULL) {
+        swipParents[frame] = parent - bufPool;
+        swizzledChildren[swipParents[frame]]++;
+    }
+}
+
+/**
+   * Turns a swizzled swip back into the page number, for a caller about to move or drop it.
+   *
+   * @param swip    Reference to unswizzle
+   */
+void BufMgr::unswizzle(Swip& swip)
+{
+    if (!swip.isSwizzled())
+        return;
+    const FrameId frame = swip.frame();
+    if (swipOwners[frame] != &swip)
+        return;
+    if (swipParents[frame] != numBufs)
+        swizzledChildren[swipParents[frame]]--;
+    swipOwners[frame] = NULL;
+    swipParents[frame] = numBufs;
+    swip.unswizzle(bufDescTable[frame].pageNo);
+}
+
+/**
+   * Destructor of Swip class. A swip destroyed while swizzled is unregistered first,
+   * so its frame is never left pointing at it.
+   */
+Swip::~Swip()
+{
+    if (isSwizzled() && bufMgr != NULL)
+        bufMgr->unswizzle(*this);
+}
+
+/**
+   * Turns every swip pointing at a frame, or read from the page in it, back into page numbers.
+   * Called before the frame is cleared.
+   *
+   * @param frame   Frame number
+   */
+void BufMgr::unswizzleFrame(const FrameId frame)
+{
+    if (swipOwners[frame] != NULL)
+        unswizzle(*swipOwners[frame]);
+    // swips read from this page must not outlive it in swizzled form
+    for (FrameId i = 0; swizzledChildren[frame] > 0 && i < numBufs; i++)
+        if (swipParents[i] == frame)
+            unswizzle(*swipOwners[i]);
 }
 
 /**
@@ -170,15 +536,314 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
         return;
     }
     // if this page is in the hash table
+    unPinFrame(temp, dirty);
+}
+
+/**
+   * Unpin a page read through a swip. While the swip is swizzled the frame is found without
+   * a hash table lookup.
+   *
+   * @param file    File object
+   * @param swip    Reference the page was read through
+   * @param dirty   True if the page to be unpinned needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+   */
+void BufMgr::unPinPage(File* file, const Swip& swip, const bool dirty)
+{
+    if (!swip.isSwizzled()) {
+        unPinPage(file, swip.pageNo(), dirty);
+        return;
+    }
+    unPinFrame(swip.frame(), dirty);
+}
+
+/**
+   * Unpin the page in a frame.
+   *
+   * @param temp    Frame number
+   * @param dirty   True if the page to be unpinned needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+   */
+void BufMgr::unPinFrame(const FrameId temp, const bool dirty)
+{
     if (bufDescTable[temp].pinCnt == 0){
         // if the page is not pinned, throw page not pinned exception
-        throw PageNotPinnedException((*file).filename(), pageNo, temp);
+        throw PageNotPinnedException((*bufDescTable[temp].file).filename(),
+          bufDescTable[temp].pageNo, temp);
     }else {
         // if this page's pin is bigger than zero
         bufDescTable[temp].pinCnt = bufDescTable[temp].pinCnt - 1;
-        if (dirty == true)
+        if (dirty == true) {
             bufDescTable[temp].dirty = true;
+            // without a recorded range the whole page may have changed
+            dirtySectors[temp] = ALL_SECTORS;
+        }
+        // optimistic readers of the old contents fail validation, and a frame
+        // left odd by beginPageWrite() becomes readable again even if unpinned clean
+        if (dirty == true || (frameVersions[temp].load(std::memory_order_relaxed) & 1))
+            publishFrame(temp);
+    }
+}
+
+/**
+   * Records that the caller changed a byte range of a page it has pinned, and marks the page dirty.
+   * Only the sectors covering recorded ranges count as dirtied, unlike unPinPage() with dirty set,
+   * which dirties the whole page. A page modified this way can be unpinned with dirty false.
+   * As for any modification, call beginPageWrite() before changing the page; the frame is
+   * published again when the page is unpinned. Record changes are better made through
+   * insertRecord(), updateRecord() and deleteRecord(), which do both.
+   *
+   * @param file    File object
+   * @param PageNo  Page number
+   * @param offset  Offset of the first changed byte in the page
+   * @param length  Number of changed bytes
+   * @throws  PageNotPinnedException If the page is not pinned
+   */
+void BufMgr::markDirty(File* file, const PageId pageNo, const std::uint32_t offset, const std::uint32_t length)
+{
+    const FrameId temp = pinnedFrame(file, pageNo);
+    // in case the caller did not announce the write, readers that start now still fail
+    invalidateFrame(temp);
+    markSectors(temp, offset, length);
+}
+
+/**
+   * Inserts a record into a page the caller has pinned, announcing the write to optimistic
+   * readers and recording the header, slot and record bytes it changed, read from the slot.
+   * The page can be unpinned with dirty false.
+   *
+   * @param file    File object
+   * @param PageNo  Page number
+   * @param record  Record data to insert
+   * @return  Identifier of the inserted record
+   * @throws  PageNotPinnedException If the page is not pinned
+   * @throws  InsufficientSpaceException If the record does not fit; the page is then unchanged
+   */
+RecordId BufMgr::insertRecord(File* file, const PageId pageNo, const std::string& record)
+{
+    const FrameId temp = pinnedFrame(file, pageNo);
+    invalidateFrame(temp);
+    const RecordId rid = bufPool[temp].insertRecord(record);
+    const PageSlot& slot = static_cast<const Page&>(bufPool[temp]).getSlot(rid.slot_number);
+    markSectors(temp, 0, sizeof(PageHeader));
+    markSectors(temp, slotOffset(rid.slot_number), sizeof(PageSlot));
+    markSectors(temp, pageOffset(slot.item_offset), slot.item_length);
+    return rid;
+}
+
+/**
+   * Replaces a record of a page the caller has pinned, announcing the write to optimistic
+   * readers and recording the bytes it changed. Page moves the records stored below the old
+   * one up over it and puts the new one below them, so the bytes from the lower of the two
+   * upper bounds to the end of the old record change. If any record moved, its slot changed
+   * too and all slots count as changed, otherwise only the record's own.
+   *
+   * @param file    File object
+   * @param rid     Identifier of the record to replace
+   * @param record  New record data
+   * @throws  PageNotPinnedException If the page is not pinned
+   */
+void BufMgr::updateRecord(File* file, const RecordId& rid, const std::string& record)
+{
+    const FrameId temp = pinnedFrame(file, rid.page_number);
+    invalidateFrame(temp);
+    const Page& page = bufPool[temp];
+    const PageSlot& slot = page.getSlot(rid.slot_number);
+    const std::uint32_t end = slot.item_offset + slot.item_length;
+    const std::uint32_t upperBefore = page.header_.free_space_upper_bound;
+    const bool moved = slot.item_offset != upperBefore;
+    bufPool[temp].updateRecord(rid, record);
+    const std::uint32_t upper = std::min<std::uint32_t>(upperBefore, page.header_.free_space_upper_bound);
+    markSectors(temp, 0, sizeof(PageHeader));
+    if (moved)
+        markSectors(temp, pageOffset(0), page.header_.free_space_lower_bound);
+    else
+        markSectors(temp, slotOffset(rid.slot_number), sizeof(PageSlot));
+    markSectors(temp, pageOffset(upper), end - upper);
+}
+
+/**
+   * Deletes a record of a page the caller has pinned, announcing the write to optimistic
+   * readers and recording the bytes it changed, as for updateRecord().
+   *
+   * @param file    File object
+   * @param rid     Identifier of the record to delete
+   * @throws  PageNotPinnedException If the page is not pinned
+   */
+void BufMgr::deleteRecord(File* file, const RecordId& rid)
+{
+    const FrameId temp = pinnedFrame(file, rid.page_number);
+    invalidateFrame(temp);
+    const Page& page = bufPool[temp];
+    const PageSlot& slot = page.getSlot(rid.slot_number);
+    const std::uint32_t end = slot.item_offset + slot.item_length;
+    const std::uint32_t upper = page.header_.free_space_upper_bound;
+    const std::uint32_t lower = page.header_.free_space_lower_bound;
+    const bool moved = slot.item_offset != upper;
+    bufPool[temp].deleteRecord(rid);
+    markSectors(temp, 0, sizeof(PageHeader));
+    if (moved)
+        markSectors(temp, pageOffset(0), lower);
+    else
+        markSectors(temp, slotOffset(rid.slot_number), sizeof(PageSlot));
+    markSectors(temp, pageOffset(upper), end - upper);
+}
+
+/**
+   * Returns the frame of a page the caller has pinned.
+   *
+   * @param file    File object
+   * @param PageNo  Page number
+   * @throws  PageNotPinnedException If the page is not pinned
+   */
+FrameId BufMgr::pinnedFrame(File* file, const PageId pageNo)
+{
+    FrameId temp;
+    try {
+        hashTable->lookup(file, pageNo, temp);
+    } catch(HashNotFoundException e1) {
+        throw PageNotPinnedException((*file).filename(), pageNo, 0);
+    }
+    // the pin of a frame being read into belongs to the read
+    if (bufDescTable[temp].pinCnt == 0 || loadingFrames[temp])
+        throw PageNotPinnedException((*file).filename(), pageNo, temp);
+    return temp;
+}
+
+/**
+   * Marks the sectors covering a byte range of a frame dirty, and the frame with them.
+   *
+   * @param frame   Frame number
+   * @param offset  Offset of the first changed byte in the page
+   * @param length  Number of changed bytes
+   */
+void BufMgr::markSectors(const FrameId frame, const std::uint32_t offset, const std::uint32_t length)
+{
+    if (length == 0 || offset >= Page::SIZE)
+        return;
+    const std::uint32_t first = offset / SECTOR_SIZE;
+    const std::uint32_t last = (std::min<std::uint32_t>(offset + length, Page::SIZE) - 1) / SECTOR_SIZE;
+    for (std::uint32_t sector = first; sector <= last; sector++)
+        dirtySectors[frame] |= 1 << sector;
+    bufDescTable[frame].dirty = true;
+}
+
+/**
+   * Writes a dirty frame back to its file and accounts for the bytes written and the bytes
+   * in its dirty sectors. File only writes whole pages, so every write-back writes Page::SIZE
+   * bytes whatever changed; the dirty sector bytes measure what a backend able to write
+   * single sectors could save, nothing is saved yet.
+   *
+   * @param frame   Frame number
+   */
+void BufMgr::writeFrame(const FrameId frame)
+{
+    {
+        std::lock_guard<std::mutex> guard(fileLatch(bufDescTable[frame].file));
+        (*(bufDescTable[frame].file)).writePage(bufPool[frame]);
     }
+    bufStats.diskwrites++;
+    bytesWritten += Page::SIZE;
+    for (std::uint16_t sectors = dirtySectors[frame]; sectors != 0; sectors &= sectors - 1)
+        dirtySectorBytes += SECTOR_SIZE;
+    dirtySectors[frame] = 0;
+}
+
+/**
+   * Returns the bytes in dirty sectors of all pages written back so far. These were written
+   * as part of whole pages, see getBytesWritten().
+   */
+std::uint64_t BufMgr::getDirtySectorBytes() const
+{
+    return dirtySectorBytes;
+}
+
+/**
+   * Returns the bytes written to files by all write-backs so far, Page::SIZE each.
+   */
+std::uint64_t BufMgr::getBytesWritten() const
+{
+    return bytesWritten;
+}
+
+/**
+   * Announces that the caller is about to modify a page it has pinned, so that optimistic
+   * readers fail validation until the page is next unpinned, dirty or not. Every modification
+   * of a page that may be read optimistically must come after this call; pages changed
+   * without it must not be read optimistically meanwhile.
+   *
+   * @param file    File object
+   * @param PageNo  Page number
+   * @throws  PageNotPinnedException If the page is not pinned
+   */
+void BufMgr::beginPageWrite(File* file, const PageId pageNo)
+{
+    invalidateFrame(pinnedFrame(file, pageNo));
+}
+
+/**
+   * Starts an optimistic read of a resident page without pinning it. The caller reads
+   * bufPool[frame] and then calls validateOptimistic(); if that fails, whatever was read
+   * must be discarded. Like every other call this one must not race with other BufMgr calls,
+   * but reading the page and validating need no synchronisation.
+   *
+   * @param file     File object
+   * @param PageNo   Page number
+   * @param frame    Frame holding the page returned via this reference
+   * @param version  Version of the frame returned via this reference
+   * @return  False if the page is not resident or is being modified
+   */
+bool BufMgr::readPageOptimistic(File* file, const PageId pageNo, FrameId& frame, std::uint64_t& version)
+{
+    try {
+        hashTable->lookup(file, pageNo, frame);
+    } catch(HashNotFoundException e1) {
+        return false;
+    }
+    version = frameVersions[frame].load(std::memory_order_acquire);
+    // odd versions mark a frame whose contents are changing
+    if (version & 1)
+        return false;
+    bufDescTable[frame].refbit = true;
+    return true;
+}
+
+/**
+   * Checks that a frame has not changed since readPageOptimistic() returned the given version.
+   *
+   * @param frame    Frame returned by readPageOptimistic()
+   * @param version  Version returned by readPageOptimistic()
+   * @return  True if everything read from the frame in between is consistent
+   */
+bool BufMgr::validateOptimistic(const FrameId frame, const std::uint64_t version) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return frameVersions[frame].load(std::memory_order_relaxed) == version;
+}
+
+/**
+   * Marks a frame's contents as changing by making its version odd.
+   *
+   * @param frame    Frame number
+   */
+void BufMgr::invalidateFrame(const FrameId frame)
+{
+    const std::uint64_t version = frameVersions[frame].load(std::memory_order_relaxed);
+    if ((version & 1) == 0)
+        frameVersions[frame].store(version + 1, std::memory_order_relaxed);
+    // order the version change before the writes to the frame
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+/**
+   * Publishes a frame's new contents by moving its version to the next even value.
+   *
+   * @param frame    Frame number
+   */
+void BufMgr::publishFrame(const FrameId frame)
+{
+    const std::uint64_t version = frameVersions[frame].load(std::memory_order_relaxed);
+    frameVersions[frame].store(version + ((version & 1) ? 1 : 2), std::memory_order_release);
 }
 
 /**
@@ -195,8 +860,9 @@ void BufMgr::flushFile(const File* file)
     // go through the frame array
     for (std::uint32_t i = 0; i < numBufs; i++) {
         BufDesc temp = bufDescTable[i];
-        // check whether this frame's page belong to the given file
-        if ((*(temp.file)).filename().compare((*file).filename()) == 0) {
+        // check whether this frame's page belong to the given file,
+        // frames which hold no page have no file
+        if (temp.file != NULL && (*(temp.file)).filename().compare((*file).filename()) == 0) {
             if (temp.pinCnt > 0) {
             // if the the page is pinned, throw page pinned exception
                 throw PagePinnedException((*file).filename(), temp.pageNo, 
@@ -207,14 +873,21 @@ void BufMgr::flushFile(const File* file)
                 throw BadBufferException(temp.frameNo, temp.dirty, 
                   temp.valid, temp.refbit);
             }
+            const bool changed = temp.dirty;
             if (temp.dirty == true) {
                 // flush the page into the disk if it is dirty
                 // and set the frame to not clean
-                (*(temp.file)).writePage(bufPool[i]);
+                writeFrame(i);
                 temp.dirty = false;
             }
+            // the page is clean now, keep a copy in the second-level cache
+            if (secondaryCache != NULL)
+                secondaryCache->admit(temp.file, bufPool[i], changed);
             // remove page from the hashtable
             hashTable->remove(file, temp.pageNo);
+            frameQuotas[i]->resident--;
+            unswizzleFrame(i);
+            invalidateFrame(i);
             // clear the bufdesc
             bufDescTable[i].Clear();
         }
@@ -231,19 +904,28 @@ void BufMgr::flushFile(const File* file)
    */
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
+  bufStats.accesses++;
   // allocate a new page in the file
+  std::unique_lock<std::mutex> guard(fileLatch(file));
   badgerdb::Page new_page = file->allocatePage();
+  guard.unlock();
   // return the new page's page number
   pageNo = new_page.page_number();
+  const std::uint64_t sampleKey = missRatioCurve.sampleKey(file, pageNo);
+  missRatioCurve.sample(sampleKey);
   //obtain next frame
-  allocBuf(clockHand);
-  // update the new page into the frame
+  allocBuf(clockHand, file);
+  // update the new page into the frame, copying into its storage as installPage() does
+  invalidateFrame(clockHand);
   bufPool[clockHand] = new_page;
   // add the relation to hash table
-  std::cout<<"Here \n";
   hashTable->insert(file, pageNo, clockHand);
   // allocate the page to the frame
   bufDescTable[clockHand].Set(file, pageNo);
+  frameQuotas[clockHand] = &fileQuota(file);
+  frameQuotas[clockHand]->resident++;
+  frameSampleKeys[clockHand] = sampleKey;
+  publishFrame(clockHand);
   //return the pointer to the allocated page
   page = &(bufPool[clockHand]); 
 }
@@ -266,14 +948,31 @@ void BufMgr::disposePage(File* file, const PageId PageNo)
          throw PagePinnedException(file->filename(), PageNo, frameNo);
       // remove the relation in the hash table
       hashTable->remove(file, PageNo);
+      frameQuotas[frameNo]->resident--;
+      unswizzleFrame(frameNo);
+      invalidateFrame(frameNo);
+      dirtySectors[frameNo] = 0;
       // clear the frame
       bufDescTable[frameNo].Clear();
     } catch(HashNotFoundException e1){
     }
+    // a cached copy must not come back if the page number is reused
+    if (secondaryCache != NULL)
+      secondaryCache->invalidate(file, PageNo);
     // delete the page from file
+    std::lock_guard<std::mutex> guard(fileLatch(file));
     (*file).deletePage(PageNo);
 }
 
+/**
+   * Forgets the references seen by the miss-ratio curve. Call it with clearBufStats() so that
+   * predicted and observed hit ratios cover the same references.
+   */
+void BufMgr::clearMissRatioCurve()
+{
+  missRatioCurve.clear();
+}
+
 void BufMgr::printSelf(void) 
 {
   BufDesc* tmpbuf;
@@ -294,6 +993,12 @@ void BufMgr::printSelf(void)
   }
 
   std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
+  // predicted hit ratios for a pool half, as large as and twice this one
+  const std::uint32_t sizes[3] = {numBufs / 2, numBufs, numBufs * 2};
+  for (int s = 0; s < 3; s++)
+    if (sizes[s] > 0)
+      std::cout << "Predicted Hit Ratio at " << sizes[s] << " Frames:"
+        << missRatioCurve.predictHitRatio(sizes[s]) << "\n";
 }
 
 }
@@ -0,0 +1,56 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief Frame quota of one file in the buffer pool, with its residency and hit counters.
+ *
+ * While a file holds no more than reserve frames, victim selection does not
+ * take its frames for other files. A file holding cap frames or more only
+ * gets new frames by evicting its own pages.
+ */
+struct FileQuota {
+  /**
+   * Frames of this file which other files may not take.
+   */
+  std::uint32_t reserve;
+
+  /**
+   * Most frames this file may hold.
+   */
+  std::uint32_t cap;
+
+  /**
+   * Frames currently holding a page of this file.
+   */
+  std::uint32_t resident;
+
+  /**
+   * Reads of this file's pages served from the pool.
+   */
+  std::uint64_t hits;
+
+  /**
+   * Reads of this file's pages which went to the file.
+   */
+  std::uint64_t misses;
+
+  /**
+   * Constructor of FileQuota struct. No reservation and a cap of the whole pool.
+   *
+   * @param bufs  Number of frames in the pool
+   */
+  explicit FileQuota(std::uint32_t bufs)
+    : reserve(0), cap(bufs), resident(0), hits(0), misses(0) {}
+};
+
+}
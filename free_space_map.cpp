@@ -0,0 +1,244 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "free_space_map.h"
+#include "file_iterator.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+FreeSpaceMap::FreeSpaceMap(BufMgr* bufMgr, File* dataFile, File* mapFile)
+  : bufMgr(bufMgr), dataFile(dataFile), mapFile(mapFile),
+    bucketHint(256, Page::INVALID_NUMBER) {
+  // rebuild the summary and the hints from the map pages already on disk
+  for (FileIterator iter = mapFile->begin(); iter != mapFile->end(); ++iter) {
+    const PageId mapPageNo = (*iter).page_number();
+    const RecordId rid = {mapPageNo, MAP_SLOT};
+    const std::string entries = (*iter).getRecord(rid);
+    if (maxBucket.size() < mapPageNo)
+      maxBucket.resize(mapPageNo, 0);
+    maxBucket[mapPageNo - 1] = (std::uint8_t) *std::max_element(
+      entries.begin(), entries.end(),
+      [](char a, char b) { return (std::uint8_t) a < (std::uint8_t) b; });
+    hintBuckets(mapPageNo, entries);
+  }
+}
+
+/**
+   * Records the buckets of the data pages described by a map page as hints.
+   *
+   * @param mapPageNo  Page number in the map file
+   * @param entries    Entries stored on that map page
+   */
+void FreeSpaceMap::hintBuckets(const PageId mapPageNo, const std::string& entries)
+{
+  for (std::uint32_t j = 0; j < entries.size(); j++)
+    bucketHint[(std::uint8_t) entries[j]] = (mapPageNo - 1) * ENTRIES_PER_PAGE + j + 1;
+}
+
+/**
+   * Converts a byte count into the bucket that is guaranteed to hold it.
+   */
+std::uint8_t FreeSpaceMap::toBucket(const std::uint16_t freeBytes)
+{
+  return (std::uint8_t) std::min(freeBytes / BUCKET_BYTES, 255);
+}
+
+/**
+   * Converts a byte count into the smallest bucket large enough for it.
+   */
+std::uint8_t FreeSpaceMap::bucketsFor(const std::uint16_t bytes)
+{
+  return (std::uint8_t) std::min((bytes + BUCKET_BYTES - 1) / BUCKET_BYTES, 255);
+}
+
+/**
+   * Appends empty map pages until the given map page exists.
+   *
+   * @param mapPageNo  Page number in the map file that must exist
+   */
+void FreeSpaceMap::extendTo(const PageId mapPageNo)
+{
+  while (maxBucket.size() < mapPageNo) {
+    PageId newPageNo;
+    Page* page;
+    bufMgr->allocPage(mapFile, newPageNo, page);
+    // a fresh map page describes pages that have no free space yet
+    bufMgr->insertRecord(mapFile, newPageNo, std::string(ENTRIES_PER_PAGE, '\0'));
+    bufMgr->unPinPage(mapFile, newPageNo, false);
+    maxBucket.push_back(0);
+  }
+}
+
+/**
+   * Sets the bucket of a data page, growing the map file if needed.
+   *
+   * @param pageNo  Page number in the data file
+   * @param bucket  New bucket of the page
+   */
+void FreeSpaceMap::setBucket(const PageId pageNo, const std::uint8_t bucket)
+{
+  const PageId mapPageNo = (pageNo - 1) / ENTRIES_PER_PAGE + 1;
+  const std::uint32_t offset = (pageNo - 1) % ENTRIES_PER_PAGE;
+  extendTo(mapPageNo);
+
+  Page* page;
+  const RecordId rid = {mapPageNo, MAP_SLOT};
+  bufMgr->readPage(mapFile, mapPageNo, page);
+  std::string entries = page->getRecord(rid);
+  const std::uint8_t old = (std::uint8_t) entries[offset];
+  if (old != bucket) {
+    entries[offset] = (char) bucket;
+    bufMgr->updateRecord(mapFile, rid, entries);
+  }
+  bufMgr->unPinPage(mapFile, mapPageNo, false);
+
+  // hints only ever name a page whose entry holds their bucket
+  if (bucketHint[old] == pageNo)
+    bucketHint[old] = Page::INVALID_NUMBER;
+  bucketHint[bucket] = pageNo;
+
+  // the summary is only an upper bound, it is tightened by findPage()
+  if (bucket > maxBucket[mapPageNo - 1])
+    maxBucket[mapPageNo - 1] = bucket;
+}
+
+/**
+   * Records the current free space of a data page.
+   *
+   * @param pageNo     Page number in the data file
+   * @param freeBytes  Free space left on the page
+   */
+void FreeSpaceMap::update(const PageId pageNo, const std::uint16_t freeBytes)
+{
+  setBucket(pageNo, toBucket(freeBytes));
+}
+
+/**
+   * Deletes a data page through the buffer manager and clears its entry.
+   *
+   * @param pageNo  Page number in the data file
+   */
+void FreeSpaceMap::disposePage(const PageId pageNo)
+{
+  bufMgr->disposePage(dataFile, pageNo);
+  setBucket(pageNo, 0);
+}
+
+/**
+   * Finds a data page which has at least the given number of free bytes. The hints are tried
+   * first, which needs no map page; only if no bucket large enough has one are the map pages
+   * read, which refills the hints.
+   *
+   * @param bytes  Number of free bytes needed
+   * @return  Page number of such a page, or Page::INVALID_NUMBER if none is known
+   */
+PageId FreeSpaceMap::findPage(const std::uint16_t bytes)
+{
+  const std::uint8_t needed = bucketsFor(bytes);
+  for (std::uint32_t bucket = needed; bucket < bucketHint.size(); bucket++)
+    if (bucketHint[bucket] != Page::INVALID_NUMBER)
+      return bucketHint[bucket];
+
+  for (std::uint32_t i = 0; i < maxBucket.size(); i++) {
+    // skip map pages which cannot describe a page with enough room
+    if (maxBucket[i] < needed)
+      continue;
+    const PageId mapPageNo = i + 1;
+    const RecordId rid = {mapPageNo, MAP_SLOT};
+    Page* page;
+    bufMgr->readPage(mapFile, mapPageNo, page);
+    const std::string entries = page->getRecord(rid);
+    bufMgr->unPinPage(mapFile, mapPageNo, false);
+    hintBuckets(mapPageNo, entries);
+
+    std::uint8_t largest = 0;
+    for (std::uint32_t j = 0; j < entries.size(); j++) {
+      const std::uint8_t bucket = (std::uint8_t) entries[j];
+      if (bucket >= needed)
+        return i * ENTRIES_PER_PAGE + j + 1;
+      largest = std::max(largest, bucket);
+    }
+    // nothing large enough here, make the summary exact
+    maxBucket[i] = largest;
+  }
+  return Page::INVALID_NUMBER;
+}
+
+/**
+   * Inserts a record into a data page with enough free space, allocating a
+   * new page in the data file only if no such page exists.
+   *
+   * @param record  Record data to insert
+   * @return  Identifier of the inserted record
+   */
+RecordId FreeSpaceMap::insertRecord(const std::string& record)
+{
+  // room for a new slot too, as Page needs when it has no free slot to reuse
+  const std::uint16_t needed = record.size() + sizeof(PageSlot);
+  PageId pageNo;
+  Page* page;
+
+  while ((pageNo = findPage(needed)) != Page::INVALID_NUMBER) {
+    try {
+      bufMgr->readPage(dataFile, pageNo, page);
+    } catch (InvalidPageException& e) {
+      // the page was deleted without telling the map, stop offering it
+      setBucket(pageNo, 0);
+      continue;
+    }
+    if (page->hasSpaceForRecord(record)) {
+      const RecordId rid = bufMgr->insertRecord(dataFile, pageNo, record);
+      const std::uint16_t freeBytes = page->getFreeSpace();
+      bufMgr->unPinPage(dataFile, pageNo, false);
+      update(pageNo, freeBytes);
+      return rid;
+    }
+    // the map overestimated this page, lower it below the request so the
+    // next probe moves on
+    const std::uint8_t bucket = std::min(toBucket(page->getFreeSpace()),
+      (std::uint8_t) (bucketsFor(needed) - 1));
+    bufMgr->unPinPage(dataFile, pageNo, false);
+    setBucket(pageNo, bucket);
+  }
+
+  // no page has enough room, grow the data file
+  bufMgr->allocPage(dataFile, pageNo, page);
+  RecordId rid;
+  try {
+    rid = bufMgr->insertRecord(dataFile, pageNo, record);
+  } catch (InsufficientSpaceException& e) {
+    // the record does not even fit on an empty page
+    const std::uint16_t freeBytes = page->getFreeSpace();
+    bufMgr->unPinPage(dataFile, pageNo, true);
+    update(pageNo, freeBytes);
+    throw;
+  }
+  const std::uint16_t freeBytes = page->getFreeSpace();
+  bufMgr->unPinPage(dataFile, pageNo, false);
+  update(pageNo, freeBytes);
+  return rid;
+}
+
+/**
+   * Deletes a record from the data file and records the space it freed.
+   *
+   * @param rid  Identifier of the record to delete
+   */
+void FreeSpaceMap::deleteRecord(const RecordId& rid)
+{
+  Page* page;
+  bufMgr->readPage(dataFile, rid.page_number, page);
+  bufMgr->deleteRecord(dataFile, rid);
+  const std::uint16_t freeBytes = page->getFreeSpace();
+  bufMgr->unPinPage(dataFile, rid.page_number, false);
+  update(rid.page_number, freeBytes);
+}
+
+}
@@ -0,0 +1,149 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Persistent map of the free space left on every page of a data file.
+ *
+ * Each data page is described by one byte holding its free space in coarse
+ * buckets of BUCKET_BYTES. The bytes are kept as a single record on each page
+ * of a companion map file, so they persist with the data file and are cached
+ * in the buffer pool like any other page. An in-memory hint of one data page
+ * in each bucket lets an insert find a page with enough room without reading
+ * the map. When the hints run out, a summary of the largest bucket on each
+ * map page lets the search go straight to a map page that can satisfy it, so
+ * the data file only grows when no page has enough room.
+ *
+ * An insert asks for room for the record and a new slot, as Page does when it
+ * has no free slot to reuse, so a page the map offers always takes the record
+ * unless it was changed without telling the map.
+ *
+ * Pages are modified through the record calls of BufMgr, so they may be read
+ * optimistically meanwhile and only the sectors changed count as dirty.
+ */
+class FreeSpaceMap {
+ public:
+  /**
+   * Number of free bytes represented by one bucket step.
+   */
+  static const std::uint16_t BUCKET_BYTES = 32;
+
+  /**
+   * Number of data pages described by one page of the map file.
+   */
+  static const std::uint32_t ENTRIES_PER_PAGE = 4096;
+
+  /**
+   * Constructor of FreeSpaceMap class. Reads the existing map file, if any,
+   * to rebuild the in-memory summary and hints.
+   *
+   * @param bufMgr    Buffer manager through which map and data pages are accessed
+   * @param dataFile  File whose pages are tracked
+   * @param mapFile   File in which the map itself is stored
+   */
+  FreeSpaceMap(BufMgr* bufMgr, File* dataFile, File* mapFile);
+
+  /**
+   * Inserts a record into a data page with enough free space, allocating a
+   * new page in the data file only if no such page exists.
+   *
+   * @param record  Record data to insert
+   * @return  Identifier of the inserted record
+   */
+  RecordId insertRecord(const std::string& record);
+
+  /**
+   * Deletes a record from the data file and records the space it freed.
+   *
+   * @param rid  Identifier of the record to delete
+   */
+  void deleteRecord(const RecordId& rid);
+
+  /**
+   * Records the current free space of a data page. Callers that modify data
+   * pages directly must call this so that the map stays accurate.
+   *
+   * @param pageNo     Page number in the data file
+   * @param freeBytes  Free space left on the page
+   */
+  void update(const PageId pageNo, const std::uint16_t freeBytes);
+
+  /**
+   * Deletes a data page through the buffer manager and clears its entry, so
+   * that the page is not handed out again. Data pages must be deleted this
+   * way rather than through BufMgr::disposePage() or File::deletePage().
+   *
+   * @param pageNo  Page number in the data file
+   */
+  void disposePage(const PageId pageNo);
+
+  /**
+   * Finds a data page which has at least the given number of free bytes.
+   *
+   * @param bytes  Number of free bytes needed
+   * @return  Page number of such a page, or Page::INVALID_NUMBER if none is known
+   */
+  PageId findPage(const std::uint16_t bytes);
+
+ private:
+  /**
+   * Slot number of the record that holds the entries on each map page.
+   */
+  static const SlotId MAP_SLOT = 1;
+
+  BufMgr* bufMgr;
+  File* dataFile;
+  File* mapFile;
+
+  /**
+   * Upper bound of the largest bucket on each map page, indexed by map page number - 1.
+   */
+  std::vector<std::uint8_t> maxBucket;
+
+  /**
+   * A data page whose entry holds each bucket, or Page::INVALID_NUMBER if none is known,
+   * indexed by bucket.
+   */
+  std::vector<PageId> bucketHint;
+
+  /**
+   * Records the buckets of the data pages described by a map page as hints.
+   */
+  void hintBuckets(const PageId mapPageNo, const std::string& entries);
+
+  /**
+   * Converts a byte count into the bucket that is guaranteed to hold it.
+   */
+  static std::uint8_t toBucket(const std::uint16_t freeBytes);
+
+  /**
+   * Converts a byte count into the smallest bucket large enough for it.
+   */
+  static std::uint8_t bucketsFor(const std::uint16_t bytes);
+
+  /**
+   * Sets the bucket of a data page, growing the map file if needed.
+   */
+  void setBucket(const PageId pageNo, const std::uint8_t bucket);
+
+  /**
+   * Appends empty map pages until the given map page exists.
+   */
+  void extendTo(const PageId mapPageNo);
+};
+
+}
@@ -12,8 +12,16 @@
 //#include <stdio.h>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 #include "page.h"
 #include "buffer.h"
+#include "async_buffer.h"
+#include "miss_ratio_curve.h"
+#include "mapped_file.h"
+#include "free_space_map.h"
+#include "swip.h"
+#include "secondary_cache.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
 #include "exceptions/file_not_found_exception.h"
@@ -46,6 +54,15 @@ void test4();
 void test5();
 void test6();
 void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
 void testBufMgr();
 
 int main() 
@@ -157,7 +174,15 @@ void testBufMgr()
 	test5();
 	test6();
 	test7();
-	// test8();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
 
 	//Close files before deleting them
 	file1.~File();
@@ -357,3 +382,483 @@ void test7()
 		std::cout << "Test 7 passed" << "\n";
 	}
 }
+
+void test8()
+{
+	//Records reinserted after deletes should reuse the freed space instead of growing the file
+	const std::string& dataname = "test.fsm";
+	const std::string& mapname = "test.fsm.map";
+	try
+	{
+		File::remove(dataname);
+		File::remove(mapname);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		File datafile = File::create(dataname);
+		File mapfile = File::create(mapname);
+		FreeSpaceMap fsm(bufMgr, &datafile, &mapfile);
+
+		for (i = 0; i < num; i++)
+		{
+			sprintf((char*)tmpbuf, "test.fsm Record %d %7.1f", i, (float)i);
+			rid[i] = fsm.insertRecord(tmpbuf);
+		}
+		PageId lastPage = 0;
+		for (i = 0; i < num; i++)
+			if (rid[i].page_number > lastPage)
+				lastPage = rid[i].page_number;
+
+		for (i = 0; i < num; i += 2)
+			fsm.deleteRecord(rid[i]);
+		for (i = 0; i < num; i += 2)
+		{
+			sprintf((char*)tmpbuf, "test.fsm Record %d %7.1f", i, (float)i);
+			rid[i] = fsm.insertRecord(tmpbuf);
+			if (rid[i].page_number > lastPage)
+			{
+				PRINT_ERROR("ERROR :: Free space was not reused. File should not have grown.");
+			}
+		}
+
+		for (i = 0; i < num; i++)
+		{
+			bufMgr->readPage(&datafile, rid[i].page_number, page);
+			sprintf((char*)tmpbuf, "test.fsm Record %d %7.1f", i, (float)i);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			bufMgr->unPinPage(&datafile, rid[i].page_number, false);
+		}
+
+		//A disposed page has room on the map but must not be offered to inserts
+		fsm.deleteRecord(rid[0]);
+		fsm.disposePage(rid[0].page_number);
+		sprintf((char*)tmpbuf, "test.fsm Record %d %7.1f", 0, (float)0);
+		try
+		{
+			fsm.insertRecord(tmpbuf);
+		}
+		catch(InvalidPageException e)
+		{
+			PRINT_ERROR("ERROR :: Disposed page was offered for an insert.");
+		}
+
+		bufMgr->flushFile(&datafile);
+		bufMgr->flushFile(&mapfile);
+	}
+
+	File::remove(dataname);
+	File::remove(mapname);
+
+	std::cout << "Test 8 passed" << "\n";
+}
+
+void test9()
+{
+	//Reserved pages of one file should survive a scan of another file that has to evict,
+	//and a capped file should never hold more frames than its cap
+	bufMgr->setFileQuota(file3ptr, 10, num);
+
+	for (i = 1; i <= 10; i++)
+	{
+		bufMgr->readPage(file3ptr, i, page);
+		bufMgr->unPinPage(file3ptr, i, false);
+	}
+
+	//file1 is not capped, so scanning as many pages as the pool has frames
+	//goes round the clock and reaches every frame of file3
+	for (i = 1; i <= num; i++)
+	{
+		bufMgr->readPage(file1ptr, i, page);
+		bufMgr->unPinPage(file1ptr, i, false);
+	}
+
+	if (bufMgr->getFileQuota(file3ptr).resident != 10)
+	{
+		PRINT_ERROR("ERROR :: Reserved frames were taken by another file.");
+	}
+
+	std::uint64_t hits = bufMgr->getFileQuota(file3ptr).hits;
+	for (i = 1; i <= 10; i++)
+	{
+		bufMgr->readPage(file3ptr, i, page);
+		bufMgr->unPinPage(file3ptr, i, false);
+	}
+	if (bufMgr->getFileQuota(file3ptr).hits != hits + 10)
+	{
+		PRINT_ERROR("ERROR :: Reserved pages were not served from the buffer pool.");
+	}
+
+	bufMgr->flushFile(file1ptr);
+	bufMgr->setFileQuota(file1ptr, 0, num/5);
+	for (i = 1; i <= num; i++)
+	{
+		bufMgr->readPage(file1ptr, i, page);
+		bufMgr->unPinPage(file1ptr, i, false);
+		if (bufMgr->getFileQuota(file1ptr).resident > num/5)
+		{
+			PRINT_ERROR("ERROR :: File holds more frames than its cap.");
+		}
+	}
+
+	bufMgr->setFileQuota(file1ptr, 0, num);
+	bufMgr->setFileQuota(file3ptr, 0, num);
+
+	std::cout << "Test 9 passed" << "\n";
+}
+
+void test10()
+{
+	//A swip followed from a parent page should be swizzled while both pages are resident
+	//and hold the page number again once the parent leaves the buffer pool
+	bufMgr->readPage(file1ptr, 1, page);
+	Swip child(2);
+	bufMgr->readPage(file1ptr, child, page2, page);
+	if (!child.isSwizzled())
+	{
+		PRINT_ERROR("ERROR :: Swip was not swizzled.");
+	}
+	bufMgr->unPinPage(file1ptr, child, false);
+
+	bufMgr->readPage(file1ptr, child, page3, page);
+	if (page3 != page2)
+	{
+		PRINT_ERROR("ERROR :: Swizzled swip did not lead to the resident page.");
+	}
+	bufMgr->unPinPage(file1ptr, child, false);
+	bufMgr->unPinPage(file1ptr, 1, false);
+
+	//A swip destroyed while swizzled should give up its frame
+	{
+		Swip temp(3);
+		bufMgr->readPage(file1ptr, temp, page2, NULL);
+		bufMgr->unPinPage(file1ptr, temp, false);
+	}
+	Swip again(3);
+	bufMgr->readPage(file1ptr, again, page2, NULL);
+	if (!again.isSwizzled())
+	{
+		PRINT_ERROR("ERROR :: Destroyed swip still held its frame.");
+	}
+	bufMgr->unPinPage(file1ptr, again, false);
+
+	bufMgr->flushFile(file1ptr);
+	if (child.isSwizzled() || child.pageNo() != 2)
+	{
+		PRINT_ERROR("ERROR :: Swip was not unswizzled when its pages left the buffer pool.");
+	}
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Pages leaving the buffer pool should be served from the second-level cache
+	//instead of the file, with the same contents
+	SecondaryCache cache(".", num);
+	bufMgr->setSecondaryCache(&cache);
+
+	for (i = 1; i <= num; i++)
+	{
+		bufMgr->readPage(file1ptr, i, page);
+		bufMgr->unPinPage(file1ptr, i, false);
+	}
+	bufMgr->flushFile(file1ptr);
+
+	int diskreads = bufMgr->getBufStats().diskreads;
+	for (i = 1; i <= num; i++)
+	{
+		bufMgr->readPage(file1ptr, i, page);
+		bufMgr->unPinPage(file1ptr, i, false);
+	}
+	if (bufMgr->getBufStats().diskreads != diskreads || cache.getHits() != num)
+	{
+		PRINT_ERROR("ERROR :: Pages were not served from the second-level cache.");
+	}
+
+	//A disposed page must not be served from the cache
+	bufMgr->flushFile(file1ptr);
+	bufMgr->disposePage(file1ptr, num);
+	try
+	{
+		bufMgr->readPage(file1ptr, num, page);
+		PRINT_ERROR("ERROR :: Disposed page was served from the second-level cache.");
+	}
+	catch(InvalidPageException e)
+	{
+	}
+
+	bufMgr->setSecondaryCache(NULL);
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//A record updated through the buffer manager should only dirty the sectors it changed,
+	//the header and slot in the first and the record in the last,
+	//while a page unpinned dirty counts as dirty as a whole
+	bufMgr->flushFile(file1ptr);
+	std::uint64_t dirtied = bufMgr->getDirtySectorBytes();
+	std::uint64_t written = bufMgr->getBytesWritten();
+
+	//page 1 of file1 holds the one record test1 put there
+	RecordId first = {1, 1};
+	bufMgr->readPage(file1ptr, 1, page);
+	sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", 2, (float)2);
+	bufMgr->updateRecord(file1ptr, first, tmpbuf);
+	bufMgr->unPinPage(file1ptr, 1, false);
+	bufMgr->flushFile(file1ptr);
+	if (bufMgr->getDirtySectorBytes() - dirtied != 2 * 512 || bufMgr->getBytesWritten() - written != Page::SIZE)
+	{
+		PRINT_ERROR("ERROR :: Dirty sectors were not tracked.");
+	}
+
+	bufMgr->readPage(file1ptr, 1, page);
+	if(strncmp(page->getRecord(first).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+	bufMgr->unPinPage(file1ptr, 1, true);
+	bufMgr->flushFile(file1ptr);
+	if (bufMgr->getDirtySectorBytes() - dirtied != 2 * 512 + Page::SIZE)
+	{
+		PRINT_ERROR("ERROR :: Page unpinned dirty was not dirty as a whole.");
+	}
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//An optimistic read should fail validation once a write to the page has been announced,
+	//and the page should be readable optimistically again after it is unpinned, even clean
+	FrameId frame;
+	std::uint64_t version;
+	bufMgr->readPage(file1ptr, 1, page);
+	if (!bufMgr->readPageOptimistic(file1ptr, 1, frame, version))
+	{
+		PRINT_ERROR("ERROR :: Resident page could not be read optimistically.");
+	}
+	bufMgr->beginPageWrite(file1ptr, 1);
+	if (bufMgr->validateOptimistic(frame, version))
+	{
+		PRINT_ERROR("ERROR :: Optimistic read was validated during a write.");
+	}
+	bufMgr->unPinPage(file1ptr, 1, false);
+	if (!bufMgr->readPageOptimistic(file1ptr, 1, frame, version)
+		|| !bufMgr->validateOptimistic(frame, version))
+	{
+		PRINT_ERROR("ERROR :: Page stayed invalid after being unpinned.");
+	}
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+/**
+ * Coroutine that starts eagerly and frees itself when done.
+ */
+struct Detached {
+	struct promise_type {
+		Detached get_return_object() { return Detached(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+/**
+ * Number of readAsync() coroutines still running.
+ */
+struct AsyncReads {
+	std::mutex latch;
+	std::condition_variable done;
+	int remaining;
+};
+
+Detached readAsync(AsyncBufMgr& asyncMgr, File* file, PageId pageNo, Page*& result, bool& failed, AsyncReads& reads)
+{
+	try
+	{
+		result = co_await asyncMgr.readPageAsync(file, pageNo);
+	}
+	catch(InvalidPageException e)
+	{
+		failed = true;
+	}
+	std::lock_guard<std::mutex> guard(reads.latch);
+	if (--reads.remaining == 0)
+		reads.done.notify_one();
+}
+
+void test14()
+{
+	//A resident page should be read without suspending, concurrent misses on one page
+	//should share a single read, and a failed read should reach every coroutine awaiting it
+	Executor executor(1);
+	AsyncBufMgr asyncMgr(bufMgr, &executor, 1);
+
+	asyncMgr.readPage(file1ptr, 1, page);
+	asyncMgr.unPinPage(file1ptr, 1, false);
+	ReadPageAwaiter hit = asyncMgr.readPageAsync(file1ptr, 1);
+	if (!hit.await_ready())
+	{
+		PRINT_ERROR("ERROR :: Resident page was not read without suspending.");
+	}
+	if (hit.await_resume() != page)
+	{
+		PRINT_ERROR("ERROR :: Resident page was not served from its frame.");
+	}
+	asyncMgr.unPinPage(file1ptr, 1, false);
+
+	asyncMgr.flushFile(file1ptr);
+	int diskreads = bufMgr->getBufStats().diskreads;
+	AsyncReads reads;
+	Page* pages[2] = {NULL, NULL};
+	bool failed[2] = {false, false};
+	reads.remaining = 2;
+	for (int n = 0; n < 2; n++)
+		readAsync(asyncMgr, file1ptr, 2, pages[n], failed[n], reads);
+	{
+		std::unique_lock<std::mutex> guard(reads.latch);
+		reads.done.wait(guard, [&reads] { return reads.remaining == 0; });
+	}
+	if (bufMgr->getBufStats().diskreads != diskreads + 1 || pages[0] == NULL || pages[1] != pages[0])
+	{
+		PRINT_ERROR("ERROR :: Concurrent misses on a page were not served by one read.");
+	}
+	asyncMgr.unPinPage(file1ptr, 2, false);
+	asyncMgr.unPinPage(file1ptr, 2, false);
+
+	//test11 disposed page num of file1
+	reads.remaining = 2;
+	for (int n = 0; n < 2; n++)
+		readAsync(asyncMgr, file1ptr, num, pages[n], failed[n], reads);
+	{
+		std::unique_lock<std::mutex> guard(reads.latch);
+		reads.done.wait(guard, [&reads] { return reads.remaining == 0; });
+	}
+	if (!failed[0] || !failed[1])
+	{
+		PRINT_ERROR("ERROR :: Failed read did not reach every coroutine awaiting it.");
+	}
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//A cyclic scan over k pages misses in an LRU pool of fewer than k frames and hits
+	//in one of k frames or more, once every page has been seen
+	const PageId k = 1000;
+	const int rounds = 10;
+	MissRatioCurve exact(1.0);
+	for (int round = 0; round < rounds; round++)
+		for (i = 1; i <= k; i++)
+			exact.sample(file1ptr, i);
+	if (exact.predictHitRatio(k - 1) != 0.0 || exact.predictHitRatio(k / 2) != 0.0)
+	{
+		PRINT_ERROR("ERROR :: Cyclic scan was predicted to hit in a pool smaller than the scan.");
+	}
+	if (exact.predictHitRatio(k) < 0.85 || exact.predictHitRatio(2 * k) < 0.85)
+	{
+		PRINT_ERROR("ERROR :: Cyclic scan was not predicted to hit in a pool as large as the scan.");
+	}
+
+	//sampling a tenth of the pages should give the same curve, up to sampling noise
+	const PageId large = 10 * k;
+	MissRatioCurve sampled(0.1);
+	for (int round = 0; round < rounds; round++)
+		for (i = 1; i <= large; i++)
+			sampled.sample(file1ptr, i);
+	if (sampled.predictHitRatio(large / 2) > 0.1 || sampled.predictHitRatio(2 * large) < 0.85)
+	{
+		PRINT_ERROR("ERROR :: Sampled miss-ratio curve did not follow the cyclic scan.");
+	}
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//Pages written through File should read back the same through a mapping,
+	//whether they are scanned in order, with read-ahead, or probed at random without it
+	const std::string& mapname = "test.mmap";
+	try
+	{
+		File::remove(mapname);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		File mapfile = File::create(mapname);
+		for (i = 0; i < num; i++)
+		{
+			Page newPage = mapfile.allocatePage();
+			sprintf((char*)tmpbuf, "test.mmap Page %d %7.1f", newPage.page_number(), (float)newPage.page_number());
+			rid[i] = newPage.insertRecord(tmpbuf);
+			mapfile.writePage(newPage);
+		}
+
+		MappedFile mapped(mapname);
+		if (mapped.numPages() != num)
+		{
+			PRINT_ERROR("ERROR :: Mapping does not cover the pages written.");
+		}
+		std::uint16_t length;
+		//in order, long enough a run to switch read-ahead on
+		for (i = 0; i < num; i++)
+		{
+			const char* record = mapped.getRecord(rid[i], length);
+			sprintf((char*)tmpbuf, "test.mmap Page %d %7.1f", rid[i].page_number, (float)rid[i].page_number);
+			if (record == NULL || length != strlen(tmpbuf) || strncmp(record, tmpbuf, length) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		//a stride that never visits consecutive pages switches read-ahead off
+		for (PageId n = 0; n < num; n++)
+		{
+			i = (n * 37) % num;
+			const char* record = mapped.getRecord(rid[i], length);
+			sprintf((char*)tmpbuf, "test.mmap Page %d %7.1f", rid[i].page_number, (float)rid[i].page_number);
+			if (record == NULL || length != strlen(tmpbuf) || strncmp(record, tmpbuf, length) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+
+		//pages appended after mapping are seen once it is refreshed
+		Page newPage = mapfile.allocatePage();
+		rid2 = newPage.insertRecord("test.mmap appended");
+		mapfile.writePage(newPage);
+		mapped.refresh();
+		const char* record = mapped.getRecord(rid2, length);
+		if (record == NULL || strncmp(record, "test.mmap appended", length) != 0)
+		{
+			PRINT_ERROR("ERROR :: Appended page was not seen after refresh.");
+		}
+
+		//deleted pages are not handed out
+		mapfile.deletePage(rid[0].page_number);
+		try
+		{
+			mapped.getRecord(rid[0], length);
+			PRINT_ERROR("ERROR :: Deleted page was read through the mapping.");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+	}
+
+	File::remove(mapname);
+
+	std::cout << "Test 16 passed" << "\n";
+}
@@ -0,0 +1,162 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_file.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+MappedFile::MappedFile(const std::string& filename)
+  : name(filename), fd(-1), base(NULL), length(0), mappedPages(0),
+    lastPage(Page::INVALID_NUMBER), runLength(0), advice(ADVICE_NONE) {
+  fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw FileNotFoundException(filename);
+  map();
+}
+
+/**
+   * Destructor of MappedFile class
+   */
+MappedFile::~MappedFile() {
+  unmap();
+  if (fd >= 0)
+    ::close(fd);
+}
+
+/**
+   * Maps the whole file read-only.
+   */
+void MappedFile::map()
+{
+  struct stat st;
+  if (::fstat(fd, &st) != 0)
+    throw FileNotFoundException(name);
+  length = st.st_size;
+  // pages follow the file header, see File::pagePosition()
+  mappedPages = length > sizeof(FileHeader)
+    ? (length - sizeof(FileHeader)) / Page::SIZE : 0;
+  if (length == 0)
+    return;
+
+  void* addr = ::mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    length = 0;
+    mappedPages = 0;
+    throw FileNotFoundException(name);
+  }
+  base = static_cast<const char*>(addr);
+  advice = ADVICE_NONE;
+}
+
+/**
+   * Unmaps the file if it is mapped.
+   */
+void MappedFile::unmap()
+{
+  if (base != NULL)
+    ::munmap(const_cast<char*>(base), length);
+  base = NULL;
+  length = 0;
+  mappedPages = 0;
+}
+
+/**
+   * Remaps the file if its size changed since it was mapped.
+   */
+void MappedFile::refresh()
+{
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && (std::size_t) st.st_size == length)
+    return;
+  unmap();
+  map();
+}
+
+/**
+   * Tracks the access pattern and switches the madvise hint when it changes.
+   * Runs of SEQUENTIAL_RUN consecutive pages turn on read-ahead, anything
+   * else turns it off so random probes do not drag in neighbouring pages.
+   *
+   * @param pageNo  Page number being accessed
+   */
+void MappedFile::noteAccess(const PageId pageNo)
+{
+  if (pageNo == lastPage + 1)
+    runLength++;
+  else if (pageNo != lastPage)
+    runLength = 0;
+  lastPage = pageNo;
+
+  const Advice wanted = runLength >= SEQUENTIAL_RUN ? ADVICE_SEQUENTIAL : ADVICE_RANDOM;
+  // only pay for the system call when the pattern changes
+  if (wanted == advice)
+    return;
+  ::madvise(const_cast<char*>(base), length,
+    wanted == ADVICE_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+  advice = wanted;
+}
+
+/**
+   * Returns the start of a page inside the mapping and updates the access hint.
+   *
+   * @param pageNo  Page number in the file
+   * @throws InvalidPageException If the page does not exist or is not in use
+   */
+const char* MappedFile::pageStart(const PageId pageNo)
+{
+  if (pageNo == Page::INVALID_NUMBER || pageNo > mappedPages)
+    throw InvalidPageException(pageNo, name);
+  const char* start = base + sizeof(FileHeader) + (std::size_t) (pageNo - 1) * Page::SIZE;
+  // freed pages keep an invalid number in their header
+  if (reinterpret_cast<const PageHeader*>(start)->current_page_number != pageNo)
+    throw InvalidPageException(pageNo, name);
+  noteAccess(pageNo);
+  return start;
+}
+
+/**
+   * Returns the header of a page inside the mapping.
+   *
+   * @param pageNo  Page number in the file
+   * @throws InvalidPageException If the page does not exist or is not in use
+   */
+const PageHeader& MappedFile::pageHeader(const PageId pageNo)
+{
+  return *reinterpret_cast<const PageHeader*>(pageStart(pageNo));
+}
+
+/**
+   * Returns a pointer to a record inside the mapping, laid out as Page stores
+   * it: the slot array starts the data area and slot numbers start at 1.
+   *
+   * @param rid           Identifier of the record
+   * @param recordLength  Length of the record returned via this reference
+   * @return  Pointer to the record data, or NULL if the slot is not in use
+   * @throws InvalidPageException If the page does not exist or is not in use
+   */
+const char* MappedFile::getRecord(const RecordId& rid, std::uint16_t& recordLength)
+{
+  const char* start = pageStart(rid.page_number);
+  const PageHeader* header = reinterpret_cast<const PageHeader*>(start);
+  const char* data = start + sizeof(PageHeader);
+  recordLength = 0;
+  if (rid.slot_number == 0 || rid.slot_number > header->num_slots)
+    return NULL;
+  const PageSlot* slot = reinterpret_cast<const PageSlot*>(data) + (rid.slot_number - 1);
+  if (!slot->used)
+    return NULL;
+  recordLength = slot->item_length;
+  return data + slot->item_offset;
+}
+
+}
@@ -0,0 +1,116 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Read-only, memory-mapped view of a database file.
+ *
+ * Meant for read-mostly analytic scans: pages are read straight out of the
+ * mapping, without a read system call or a copy into the buffer pool. The
+ * access pattern is watched so the kernel is told to read ahead for
+ * sequential scans and not to for random probes.
+ *
+ * Writes still go through File or BufMgr. The mapping is shared, so pages
+ * written back by them are visible here; call refresh() after the file grew.
+ */
+class MappedFile {
+ public:
+  /**
+   * Number of consecutive page numbers after which access is treated as sequential.
+   */
+  static const std::uint32_t SEQUENTIAL_RUN = 8;
+
+  /**
+   * Constructor of MappedFile class. Maps the whole file read-only.
+   *
+   * @param filename  Name of an existing database file
+   * @throws FileNotFoundException If the file cannot be opened
+   */
+  explicit MappedFile(const std::string& filename);
+
+  /**
+   * Destructor of MappedFile class. Unmaps the file.
+   */
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * Returns the header of a page inside the mapping.
+   *
+   * @param pageNo  Page number in the file
+   * @throws InvalidPageException If the page does not exist or is not in use
+   */
+  const PageHeader& pageHeader(const PageId pageNo);
+
+  /**
+   * Returns a pointer to a record inside the mapping. The pointer stays valid
+   * until the file is unmapped or refreshed.
+   *
+   * @param rid           Identifier of the record
+   * @param recordLength  Length of the record returned via this reference
+   * @return  Pointer to the record data, or NULL if the slot is not in use
+   * @throws InvalidPageException If the page does not exist or is not in use
+   */
+  const char* getRecord(const RecordId& rid, std::uint16_t& recordLength);
+
+  /**
+   * Returns the number of page positions covered by the mapping.
+   */
+  PageId numPages() const { return mappedPages; }
+
+  /**
+   * Remaps the file if its size changed since it was mapped.
+   */
+  void refresh();
+
+  /**
+   * Returns the name of the mapped file.
+   */
+  const std::string& filename() const { return name; }
+
+ private:
+  enum Advice { ADVICE_NONE, ADVICE_SEQUENTIAL, ADVICE_RANDOM };
+
+  std::string name;
+  int fd;
+  const char* base;
+  std::size_t length;
+  PageId mappedPages;
+
+  /**
+   * Last page accessed and length of the run of consecutive pages ending there.
+   */
+  PageId lastPage;
+  std::uint32_t runLength;
+  Advice advice;
+
+  void map();
+  void unmap();
+
+  /**
+   * Returns the start of a page inside the mapping and updates the access hint.
+   */
+  const char* pageStart(const PageId pageNo);
+
+  /**
+   * Tracks the access pattern and switches the madvise hint when it changes.
+   */
+  void noteAccess(const PageId pageNo);
+};
+
+}
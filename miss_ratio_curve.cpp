@@ -0,0 +1,128 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <utility>
+#include "miss_ratio_curve.h"
+
+namespace badgerdb {
+
+MissRatioCurve::MissRatioCurve(double rate)
+  : threshold((std::uint64_t) (rate * MODULUS)), rate(rate),
+    marks(1 << 12, 0), clock(0), references(0) {
+  if (threshold == 0)
+    threshold = 1;
+  this->rate = (double) threshold / MODULUS;
+}
+
+/**
+   * Forgets all references seen so far.
+   */
+void MissRatioCurve::clear()
+{
+  lastAccess.clear();
+  std::fill(marks.begin(), marks.end(), 0);
+  clock = 0;
+  histogram.clear();
+  references = 0;
+}
+
+/**
+   * Adds delta at a logical time in the Fenwick tree.
+   */
+void MissRatioCurve::mark(std::uint32_t time, const int delta)
+{
+  for (; time < marks.size(); time += time & (~time + 1))
+    marks[time] += delta;
+}
+
+/**
+   * Returns the number of marks at logical times 1..time.
+   */
+std::uint32_t MissRatioCurve::prefix(std::uint32_t time) const
+{
+  std::uint32_t sum = 0;
+  for (; time > 0; time -= time & (~time + 1))
+    sum += marks[time];
+  return sum;
+}
+
+/**
+   * Renumbers the live last-reference times 1..n once the clock reaches the
+   * end of the Fenwick tree, growing the tree if most of it is live.
+   */
+void MissRatioCurve::compact()
+{
+  std::vector<std::pair<std::uint32_t, std::uint64_t> > live;
+  live.reserve(lastAccess.size());
+  for (auto iter = lastAccess.begin(); iter != lastAccess.end(); ++iter)
+    live.push_back(std::make_pair(iter->second, iter->first));
+  std::sort(live.begin(), live.end());
+
+  std::size_t size = marks.size();
+  while (live.size() * 2 >= size)
+    size *= 2;
+  marks.assign(size, 0);
+  for (std::uint32_t i = 0; i < live.size(); i++) {
+    lastAccess[live[i].second] = i + 1;
+    mark(i + 1, 1);
+  }
+  clock = live.size();
+}
+
+/**
+   * Records a reference to a sampled page and adds its scaled reuse distance
+   * to the histogram. First references are cold misses at any pool size and
+   * only count towards the total.
+   *
+   * @param key  Hash of the page
+   */
+void MissRatioCurve::record(const std::uint64_t key)
+{
+  if (clock + 1 >= marks.size())
+    compact();
+  const std::uint32_t now = ++clock;
+  references++;
+
+  auto iter = lastAccess.find(key);
+  if (iter != lastAccess.end()) {
+    // distinct sampled pages referenced since the last reference to this one
+    const std::uint32_t last = iter->second;
+    const std::uint32_t distance = prefix(now - 1) - prefix(last);
+    const std::uint64_t scaled = (std::uint64_t) (distance / rate);
+    if (scaled < MAX_FRAMES) {
+      if (histogram.size() <= scaled)
+        histogram.resize(scaled + 1, 0);
+      histogram[scaled]++;
+    }
+    mark(last, -1);
+    iter->second = now;
+  } else {
+    lastAccess[key] = now;
+  }
+  mark(now, 1);
+}
+
+/**
+   * Returns the hit ratio an LRU pool with the given number of frames is
+   * predicted to have had: the fraction of references whose reuse distance
+   * is smaller than the pool.
+   *
+   * @param frames  Pool size in frames
+   */
+double MissRatioCurve::predictHitRatio(const std::uint32_t frames) const
+{
+  if (references == 0)
+    return 0.0;
+  std::uint64_t hits = 0;
+  const std::size_t end = std::min((std::size_t) frames, histogram.size());
+  for (std::size_t d = 0; d < end; d++)
+    hits += histogram[d];
+  return (double) hits / references;
+}
+
+}
@@ -0,0 +1,145 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Online estimate of the buffer pool miss-ratio curve.
+ *
+ * Follows SHARDS (Waldspurger et al., FAST 2015): a reference to page
+ * (file, pageNo) is sampled only if a hash of the pair falls below a
+ * threshold, so a fixed fraction of the pages is tracked and every reference
+ * to a tracked page is seen. Reuse distances measured among the sampled
+ * pages, divided by the sampling rate, estimate the reuse distances of the
+ * full stream. They give the hit ratio an LRU pool of any size would have
+ * had, which the clock policy approximates.
+ *
+ * The common, unsampled case costs one hash and one compare.
+ */
+class MissRatioCurve {
+ public:
+  /**
+   * Largest pool size, in frames, predictions are kept for.
+   */
+  static const std::uint32_t MAX_FRAMES = 1 << 20;
+
+  /**
+   * Constructor of MissRatioCurve class.
+   *
+   * @param rate  Fraction of pages sampled, between 0 and 1
+   */
+  explicit MissRatioCurve(double rate = 0.01);
+
+  /**
+   * Key of pages whose references are not sampled.
+   */
+  static const std::uint64_t NOT_SAMPLED = ~0ull;
+
+  /**
+   * Records a reference to a page.
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file
+   */
+  void sample(const File* file, const PageId pageNo) {
+    sample(sampleKey(file, pageNo));
+  }
+
+  /**
+   * Returns the key references to a page are sampled under, or NOT_SAMPLED.
+   * A caller referencing a page repeatedly can work it out once and record
+   * every reference with sample(key), which then costs one compare.
+   *
+   * @param file    File object
+   * @param pageNo  Page number in the file
+   */
+  std::uint64_t sampleKey(const File* file, const PageId pageNo) const {
+    const std::uint64_t hash = mix((std::uint64_t) (std::uintptr_t) file ^
+      ((std::uint64_t) pageNo << 32 | pageNo));
+    return (hash & (MODULUS - 1)) < threshold ? hash : NOT_SAMPLED;
+  }
+
+  /**
+   * Records a reference to a page by the key sampleKey() returned for it.
+   *
+   * @param key  Key of the page
+   */
+  void sample(const std::uint64_t key) {
+    if (key != NOT_SAMPLED)
+      record(key);
+  }
+
+  /**
+   * Returns the hit ratio an LRU pool with the given number of frames is
+   * predicted to have had on the references seen so far.
+   *
+   * @param frames  Pool size in frames
+   */
+  double predictHitRatio(const std::uint32_t frames) const;
+
+  /**
+   * Returns the number of sampled references.
+   */
+  std::uint64_t sampledReferences() const { return references; }
+
+  /**
+   * Forgets all references seen so far.
+   */
+  void clear();
+
+ private:
+  static const std::uint64_t MODULUS = 1 << 24;
+
+  std::uint64_t threshold;
+  double rate;
+
+  /**
+   * Logical time of the last reference to every sampled page, keyed by its hash.
+   */
+  std::unordered_map<std::uint64_t, std::uint32_t> lastAccess;
+
+  /**
+   * Fenwick tree over logical time marking the last reference of every page,
+   * so the number of distinct pages referenced since a time is a range sum.
+   */
+  std::vector<std::uint32_t> marks;
+  std::uint32_t clock;
+
+  /**
+   * Number of sampled references by scaled reuse distance, in frames.
+   */
+  std::vector<std::uint64_t> histogram;
+  std::uint64_t references;
+
+  static std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+  }
+
+  void record(const std::uint64_t key);
+  void mark(std::uint32_t time, const int delta);
+  std::uint32_t prefix(std::uint32_t time) const;
+
+  /**
+   * Renumbers the live last-reference times 1..n once the clock reaches the
+   * end of the Fenwick tree.
+   */
+  void compact();
+};
+
+}
@@ -0,0 +1,254 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "secondary_cache.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+SecondaryCache::SecondaryCache(const std::string& directory, const std::uint32_t capacity,
+  const std::uint32_t maxPending)
+  : capacity(capacity), maxPending(maxPending), stopping(false), cacheFile(NULL),
+    writing(false), writeCancelled(false), nextGeneration(0),
+    hits(0), misses(0), writes(0), dropped(0) {
+  const std::string name = directory + "/pages.cache";
+  try {
+    File::remove(name);
+  } catch (FileNotFoundException e) {
+  }
+  // every slot exists before the writer starts, so it never creates or grows a file
+  cacheFile = new File(File::create(name));
+  for (std::uint32_t i = 0; i < capacity; i++)
+    freeSlots.push_back(cacheFile->allocatePage().page_number());
+  writer = std::thread(&SecondaryCache::run, this);
+}
+
+/**
+   * Destructor of SecondaryCache class
+   */
+SecondaryCache::~SecondaryCache() {
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  writer.join();
+
+  const std::string name = cacheFile->filename();
+  // close the cache file before removing it
+  delete cacheFile;
+  File::remove(name);
+}
+
+/**
+   * Removes a key from the written pages, freeing its slot, and cancels a write of it in flight.
+   * Caller holds the latch.
+   *
+   * @param key  File name and page number
+   */
+void SecondaryCache::forget(const CacheKey& key)
+{
+  if (writing && writingKey == key)
+    writeCancelled = true;
+  std::map<CacheKey, Entry>::iterator iter = index.find(key);
+  if (iter == index.end())
+    return;
+  freeSlots.push_back(iter->second.slot);
+  written.erase(iter->second.position);
+  index.erase(iter);
+}
+
+/**
+   * Removes the oldest written page, freeing its slot. Caller holds the latch.
+   */
+void SecondaryCache::forgetOldest()
+{
+  std::map<CacheKey, Entry>::iterator iter = index.find(written.front());
+  freeSlots.push_back(iter->second.slot);
+  index.erase(iter);
+  written.pop_front();
+}
+
+/**
+   * Admits a clean page leaving the buffer pool.
+   *
+   * @param file     Primary file of the page
+   * @param page     Page contents
+   * @param changed  True if the page was written back since it was read
+   */
+void SecondaryCache::admit(const File* file, const Page& page, const bool changed)
+{
+  const CacheKey key(file->filename(), page.page_number());
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    // a page read from the cache and left unchanged is cached as it is already
+    if (!changed && (index.count(key) > 0 || pending.count(key) > 0
+        || (writing && !writeCancelled && writingKey == key)))
+      return;
+    // the written copy, if any, is older than this one
+    forget(key);
+    std::map<CacheKey, Page>::iterator iter = pending.find(key);
+    if (iter != pending.end()) {
+      iter->second = page;
+      return;
+    }
+    // the queue also holds keys invalidated since, so bounding it bounds both
+    if (writeQueue.size() >= maxPending) {
+      dropped++;
+      return;
+    }
+    pending.insert(std::make_pair(key, page));
+    writeQueue.push_back(key);
+  }
+  wakeup.notify_one();
+}
+
+/**
+   * Looks a page up in the pages waiting to be written or being written, then in the
+   * cache file. The cache file is read without the latch; if the entry was dropped or rewritten
+   * meanwhile the page read may be stale, and the lookup counts as a miss.
+   *
+   * @param file    Primary file of the page
+   * @param pageNo  Page number
+   * @param page    Filled with the cached contents if found
+   * @return  True if the page was cached
+   */
+bool SecondaryCache::lookup(const File* file, const PageId pageNo, Page& page)
+{
+  const CacheKey key(file->filename(), pageNo);
+  std::unique_lock<std::mutex> guard(latch);
+  std::map<CacheKey, Page>::iterator iter = pending.find(key);
+  if (iter != pending.end()) {
+    page = iter->second;
+    hits++;
+    return true;
+  }
+  // the page is not indexed until its write is done
+  if (writing && !writeCancelled && writingKey == key) {
+    page = writingPage;
+    hits++;
+    return true;
+  }
+  std::map<CacheKey, Entry>::iterator entry = index.find(key);
+  if (entry == index.end()) {
+    misses++;
+    return false;
+  }
+  const PageId slot = entry->second.slot;
+  const std::uint64_t generation = entry->second.generation;
+  guard.unlock();
+
+  {
+    std::lock_guard<std::mutex> ioGuard(io);
+    page = cacheFile->readPage(slot);
+  }
+  page.set_page_number(pageNo);
+
+  guard.lock();
+  entry = index.find(key);
+  if (entry == index.end() || entry->second.generation != generation) {
+    misses++;
+    return false;
+  }
+  hits++;
+  return true;
+}
+
+/**
+   * Drops the cached copy of a page, if any.
+   *
+   * @param file    Primary file of the page
+   * @param pageNo  Page number
+   */
+void SecondaryCache::invalidate(const File* file, const PageId pageNo)
+{
+  const CacheKey key(file->filename(), pageNo);
+  std::lock_guard<std::mutex> guard(latch);
+  // a queued key without a pending page is skipped by the writer
+  pending.erase(key);
+  forget(key);
+}
+
+/**
+   * Drops every cached page of a file.
+   *
+   * @param file  Primary file
+   */
+void SecondaryCache::dropFile(const File* file)
+{
+  const std::string filename = file->filename();
+  std::lock_guard<std::mutex> guard(latch);
+  if (writing && writingKey.first == filename)
+    writeCancelled = true;
+  std::map<CacheKey, Page>::iterator next = pending.lower_bound(CacheKey(filename, 0));
+  while (next != pending.end() && next->first.first == filename)
+    pending.erase(next++);
+  std::map<CacheKey, Entry>::iterator first = index.lower_bound(CacheKey(filename, 0));
+  while (first != index.end() && first->first.first == filename) {
+    freeSlots.push_back(first->second.slot);
+    written.erase(first->second.position);
+    index.erase(first++);
+  }
+}
+
+/**
+   * Writer thread body: writes admitted pages to free slots of the cache file, taking the
+   * slot of the oldest written page once none is free. Each page is moved from the pending
+   * ones to writingPage under the latch and written without it; the index is only updated
+   * if nothing changed the key's cached copy in between.
+   */
+void SecondaryCache::run()
+{
+  std::unique_lock<std::mutex> guard(latch);
+  while (true) {
+    wakeup.wait(guard, [this] { return stopping || !writeQueue.empty(); });
+    if (writeQueue.empty())
+      return;
+    const CacheKey key = writeQueue.front();
+    writeQueue.pop_front();
+    std::map<CacheKey, Page>::iterator iter = pending.find(key);
+    if (iter == pending.end())
+      continue;
+    if (freeSlots.empty() && !written.empty())
+      forgetOldest();
+    if (freeSlots.empty()) {
+      // a cache without capacity keeps nothing
+      pending.erase(iter);
+      continue;
+    }
+
+    const PageId slot = freeSlots.back();
+    freeSlots.pop_back();
+    writingPage = iter->second;
+    pending.erase(iter);
+    writingKey = key;
+    writing = true;
+    writeCancelled = false;
+    guard.unlock();
+
+    {
+      // only this thread changes writingPage, so it is read without the latch
+      Page page = writingPage;
+      page.set_page_number(slot);
+      std::lock_guard<std::mutex> ioGuard(io);
+      cacheFile->writePage(page);
+    }
+    writes++;
+
+    guard.lock();
+    writing = false;
+    if (writeCancelled) {
+      freeSlots.push_back(slot);
+      continue;
+    }
+    written.push_back(key);
+    const Entry entry = {--written.end(), slot, nextGeneration++};
+    index[key] = entry;
+  }
+}
+
+}
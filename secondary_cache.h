@@ -0,0 +1,200 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Second-level page cache kept in a file on fast local storage.
+ *
+ * Pages leaving the buffer pool are admitted here and written to the cache
+ * file by a background thread, so eviction never waits for the write. At most
+ * maxPending pages wait to be written; admits beyond that are dropped. A miss
+ * in the buffer pool checks this cache, including the pages still waiting to
+ * be written or being written, before reading the primary file.
+ *
+ * The latch guarding the index is never held across file I/O. The cache file
+ * is read and written under a separate latch, so admits and lookups which
+ * need no I/O do not wait for the writer.
+ *
+ * The cache file is created with capacity pages when the cache is constructed
+ * and never grows. Each cached page takes one of those slots, and the index
+ * maps (file name, page number) to the slot. Once every slot is taken, the
+ * oldest cached page gives up its slot to the next one written.
+ *
+ * Entries are keyed by file name, so pages stay cached across reopening a
+ * file. Call dropFile() before removing or recreating a primary file.
+ * Page must declare SecondaryCache a friend, as it does File, since a page is
+ * written to its slot under the slot's page number.
+ */
+class SecondaryCache {
+ public:
+  /**
+   * Constructor of SecondaryCache class. Starts the writer thread.
+   *
+   * @param directory   Directory on local storage for the cache file
+   * @param capacity    Most pages cached, and pages in the cache file
+   * @param maxPending  Most admitted pages waiting to be written
+   */
+  SecondaryCache(const std::string& directory, const std::uint32_t capacity,
+    const std::uint32_t maxPending = 1024);
+
+  /**
+   * Destructor of SecondaryCache class. Stops the writer thread and removes the cache file.
+   */
+  ~SecondaryCache();
+
+  SecondaryCache(const SecondaryCache&) = delete;
+  SecondaryCache& operator=(const SecondaryCache&) = delete;
+
+  /**
+   * Admits a clean page leaving the buffer pool. A changed page replaces any
+   * older copy and is written to the cache file in the background, unless too
+   * many pages are waiting to be written already. An unchanged page which is
+   * cached already is left as it is.
+   *
+   * @param file     Primary file of the page
+   * @param page     Page contents
+   * @param changed  True if the page was written back since it was read
+   */
+  void admit(const File* file, const Page& page, const bool changed);
+
+  /**
+   * Looks a page up in the cache.
+   *
+   * @param file    Primary file of the page
+   * @param pageNo  Page number
+   * @param page    Filled with the cached contents if found
+   * @return  True if the page was cached
+   */
+  bool lookup(const File* file, const PageId pageNo, Page& page);
+
+  /**
+   * Drops the cached copy of a page, if any.
+   *
+   * @param file    Primary file of the page
+   * @param pageNo  Page number
+   */
+  void invalidate(const File* file, const PageId pageNo);
+
+  /**
+   * Drops every cached page of a file.
+   *
+   * @param file  Primary file
+   */
+  void dropFile(const File* file);
+
+  /**
+   * Returns the number of lookups served, missed, of pages written to the cache file
+   * and of admits dropped because too many pages were waiting.
+   */
+  std::uint64_t getHits() const { return hits; }
+  std::uint64_t getMisses() const { return misses; }
+  std::uint64_t getWrites() const { return writes; }
+  std::uint64_t getDropped() const { return dropped; }
+
+ private:
+  typedef std::pair<std::string, PageId> CacheKey;
+
+  std::uint32_t capacity;
+  std::uint32_t maxPending;
+
+  std::mutex latch;
+  std::condition_variable wakeup;
+  bool stopping;
+
+  /**
+   * Cache file, created with its capacity pages up front so that the writer
+   * thread only ever writes to it, and the latch serialising I/O on it, as
+   * File is not thread-safe.
+   */
+  File* cacheFile;
+  std::mutex io;
+
+  /**
+   * Pages of the cache file holding no cached page.
+   */
+  std::vector<PageId> freeSlots;
+
+  /**
+   * Key and page the writer is writing without the latch. Lookups are served
+   * from this copy until it is indexed. Anything that changes the cached copy
+   * of that key meanwhile cancels the write's index update. There is one
+   * writer, so this flag is the only per-key generation needed.
+   */
+  CacheKey writingKey;
+  Page writingPage;
+  bool writing;
+  bool writeCancelled;
+
+  /**
+   * Generation given to the next written page. A lookup reading a cache file
+   * without the latch checks that the entry still has the generation it saw.
+   */
+  std::uint64_t nextGeneration;
+
+  /**
+   * Admitted pages not yet written, and the order to write them in.
+   */
+  std::map<CacheKey, Page> pending;
+  std::deque<CacheKey> writeQueue;
+
+  /**
+   * Written page: its place in the oldest-first order, its slot and its generation.
+   */
+  struct Entry {
+    std::list<CacheKey>::iterator position;
+    PageId slot;
+    std::uint64_t generation;
+  };
+
+  /**
+   * Pages written to the cache file, oldest first, with an index into that order.
+   */
+  std::list<CacheKey> written;
+  std::map<CacheKey, Entry> index;
+
+  std::atomic<std::uint64_t> hits;
+  std::atomic<std::uint64_t> misses;
+  std::atomic<std::uint64_t> writes;
+  std::atomic<std::uint64_t> dropped;
+
+  std::thread writer;
+
+  /**
+   * Writer thread body.
+   */
+  void run();
+
+  /**
+   * Removes a key from the written pages, freeing its slot, and cancels a write of it in flight.
+   * Caller holds the latch.
+   */
+  void forget(const CacheKey& key);
+
+  /**
+   * Removes the oldest written page, freeing its slot. Caller holds the latch.
+   */
+  void forgetOldest();
+};
+
+}
@@ -0,0 +1,85 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+#include "page.h"
+
+namespace badgerdb {
+
+class BufMgr;
+
+/**
+ * @brief Reference from one page to another which can point straight at a frame.
+ *
+ * A swip starts out holding the page number of the page it refers to. When
+ * it is followed through BufMgr::readPage() it is swizzled: it then holds the
+ * frame of the page, and following it again skips the buffer hash table.
+ * The buffer manager turns it back into the page number when the page leaves
+ * its frame, or when the page the reference was read from leaves its own.
+ *
+ * The low bit tells the two forms apart.
+ *
+ * The buffer manager keeps the address of a swizzled swip, so swips cannot
+ * be copied or moved, and one destroyed while swizzled is unswizzled first.
+ */
+class Swip {
+ public:
+  /**
+   * Constructor of Swip class.
+   *
+   * @param pageNo  Page number the swip refers to
+   */
+  explicit Swip(const PageId pageNo = Page::INVALID_NUMBER)
+    : word((std::uint64_t) pageNo << 1), bufMgr(NULL) {}
+
+  /**
+   * Destructor of Swip class. Defined with BufMgr, which it unregisters from if swizzled.
+   */
+  ~Swip();
+
+  Swip(const Swip&) = delete;
+  Swip& operator=(const Swip&) = delete;
+
+  /**
+   * Returns true if the swip holds a frame rather than a page number.
+   */
+  bool isSwizzled() const { return (word & 1) != 0; }
+
+  /**
+   * Returns the page number. Only meaningful if the swip is not swizzled.
+   */
+  PageId pageNo() const { return (PageId) (word >> 1); }
+
+  /**
+   * Returns the frame. Only meaningful if the swip is swizzled.
+   */
+  FrameId frame() const { return (FrameId) (word >> 1); }
+
+ private:
+  friend class BufMgr;
+
+  std::uint64_t word;
+
+  /**
+   * Buffer manager holding the frame while swizzled, NULL otherwise.
+   */
+  BufMgr* bufMgr;
+
+  void swizzle(const FrameId frameNo, BufMgr* mgr) {
+    word = (std::uint64_t) frameNo << 1 | 1;
+    bufMgr = mgr;
+  }
+  void unswizzle(const PageId pageNo) {
+    word = (std::uint64_t) pageNo << 1;
+    bufMgr = NULL;
+  }
+};
+
+}